@@ -0,0 +1,261 @@
+// chip8AsmBench: assembles synthetic sources of growing size and prints one JSON object per size,
+// with the time of each phase, allocations and peak heap use
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#ifdef __linux__
+#include <sys/resource.h>
+#endif
+#include "assembler.hpp"
+
+namespace
+{
+    // heap use of the assembler, counted by the replaced operator new below
+    struct HeapStats {
+        size_t allocations {};
+        size_t liveBytes {};
+        size_t peakBytes {};
+    } heap;
+
+    constexpr size_t headerSize = alignof(std::max_align_t);
+
+    void* allocate(size_t size)
+    {
+        auto* block = static_cast<unsigned char*>(std::malloc(size + headerSize));
+        if(!block)
+            throw std::bad_alloc();
+        *reinterpret_cast<size_t*>(block) = size;
+
+        heap.allocations++;
+        heap.liveBytes += size;
+        heap.peakBytes = std::max(heap.peakBytes, heap.liveBytes);
+        return block + headerSize;
+    }
+
+    void release(void* pointer)
+    {
+        if(!pointer)
+            return;
+        auto* block = static_cast<unsigned char*>(pointer) - headerSize;
+        heap.liveBytes -= *reinterpret_cast<size_t*>(block);
+        std::free(block);
+    }
+
+    // xorshift, so every run of a size assembles the same source
+    struct Random {
+        uint64_t state;
+        uint32_t next() {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            return uint32_t(state);
+        }
+        uint32_t below(uint32_t bound) { return next() % bound; }
+    };
+
+    // every form of the opcode table except include, labels every few lines referenced from anywhere
+    // (so about half of the uses are forward references), and db blocks behind data labels
+    std::string generateSource(size_t lineCount, uint64_t seed)
+    {
+        Random random {seed * 0x9E3779B97F4A7C15ull + 1};
+        const size_t labelCount = std::max<size_t>(1, lineCount / 16);
+        std::string out;
+        out.reserve(lineCount * 20);
+
+        auto reg = [&]() { return "reg" + std::to_string(random.below(16)); };
+        auto number = [&]() {
+            const uint32_t value = random.below(256);
+            switch(random.below(3)) {
+                case 0: return std::to_string(value);
+                case 1: { char text[8]; std::snprintf(text, sizeof(text), "0x%X", value); return std::string(text); }
+                default: {
+                    std::string text = "0b";
+                    for(int bit = 7; bit >= 0; bit--) text.push_back(value >> bit & 1 ? '1' : '0');
+                    return text;
+                }
+            }
+        };
+        auto label = [&]() { return "L" + std::to_string(random.below(uint32_t(labelCount))); };
+
+        size_t line = 0;
+        size_t nextLabel = 0;
+        while(line < lineCount)
+        {
+            if(line >= nextLabel * 16 && nextLabel < labelCount) {
+                out += ": L" + std::to_string(nextLabel++) + "\n";
+                line++;
+                continue;
+            }
+            if(random.below(64) == 0) {
+                out += ": data" + std::to_string(line) + "\n";
+                for(int byteIdx = 0; byteIdx != 8 && ++line < lineCount; byteIdx++)
+                    out += "    db " + number() + "\n";
+                line++;
+                continue;
+            }
+
+            out += "    ";
+            switch(random.below(38))
+            {
+                case 0: out += "cls"; break;
+                case 1: out += "ret"; break;
+                case 2: out += "sys " + label(); break;
+                case 3: out += "call " + label(); break;
+                case 4: out += "se " + reg() + " " + number(); break;
+                case 5: out += "sne " + reg() + " " + number(); break;
+                case 6: out += "se " + reg() + " " + reg(); break;
+                case 7: out += "ld " + reg() + " " + number(); break;
+                case 8: out += "add " + reg() + " " + number(); break;
+                case 9: out += "ld " + reg() + " " + reg(); break;
+                case 10: out += "or " + reg() + " " + reg(); break;
+                case 11: out += "and " + reg() + " " + reg(); break;
+                case 12: out += "xor " + reg() + " " + reg(); break;
+                case 13: out += "add " + reg() + " " + reg(); break;
+                case 14: out += "sub " + reg() + " " + reg(); break;
+                case 15: out += "shr " + reg() + " " + reg(); break;
+                case 16: out += "subn " + reg() + " " + reg(); break;
+                case 17: out += "shl " + reg() + " " + reg(); break;
+                case 18: out += "sne " + reg() + " " + reg(); break;
+                case 19: out += "jp reg0 + " + label(); break;
+                case 20: out += "jp " + label(); break;
+                case 21: out += "rnd " + reg() + " " + number(); break;
+                case 22: out += "drw " + reg() + " " + reg() + " " + std::to_string(random.below(16)); break;
+                case 23: out += "skp " + reg(); break;
+                case 24: out += "sknp " + reg(); break;
+                case 25: out += "ld " + reg() + " delayTimer"; break;
+                case 26: out += "ld " + reg() + " keyPress"; break;
+                case 27: out += "ld delayTimer " + reg(); break;
+                case 28: out += "ld soundTimer " + reg(); break;
+                case 29: out += "add regI " + reg(); break;
+                case 30: out += "ld regI spriteOf " + reg(); break;
+                case 31: out += "ld regI " + label(); break;
+                case 32: out += "ld *regI bcdOf " + reg(); break;
+                case 33: out += "ld *regI upTo " + reg(); break;
+                case 34: out += "ld upTo " + reg() + " *regI"; break;
+                case 35: { char text[8]; std::snprintf(text, sizeof(text), "0x%X", 0x200 + random.below(0xDFF)); out += "jp "; out += text; break; }
+                case 36: out += "db " + number(); break;
+                default: out += "cls ;\"comment\""; break;
+            }
+            out += "\n";
+            line++;
+        }
+        // db blocks can push the last labels past the end, they still need a definition
+        while(nextLabel < labelCount)
+            out += ": L" + std::to_string(nextLabel++) + "\n";
+        return out;
+    }
+
+    struct Sample {
+        ModuleTimings module {};
+        double link {};
+        size_t bytes {};
+        size_t allocations {};
+        size_t peakBytes {};
+        bool success {};
+    };
+
+    Sample run(const std::string& source)
+    {
+        Sample sample;
+        const size_t allocationsBefore = heap.allocations;
+        heap.peakBytes = heap.liveBytes;
+        const size_t liveBefore = heap.liveBytes;
+        {
+            std::vector<Diagnostic> diagnostics;
+            std::vector<ObjectFile> objects(1);
+            sample.success = assembleModule(source, "bench.c8asm", objects.front(), diagnostics, &sample.module);
+
+            const auto linkStart = std::chrono::steady_clock::now();
+            AssembleResult result;
+            sample.success = sample.success && linkProgram(objects, {}, result);
+            sample.link = std::chrono::duration<double>(std::chrono::steady_clock::now() - linkStart).count();
+            sample.bytes = result.bytes.size();
+        }
+        sample.allocations = heap.allocations - allocationsBefore;
+        sample.peakBytes = heap.peakBytes - liveBefore;
+        return sample;
+    }
+
+    long maxResidentKb()
+    {
+#ifdef __linux__
+        rusage usage {};
+        getrusage(RUSAGE_SELF, &usage);
+        return usage.ru_maxrss;
+#else
+        return 0;
+#endif
+    }
+}
+
+void* operator new(size_t size) { return allocate(size); }
+void* operator new[](size_t size) { return allocate(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    try { return allocate(size); } catch(...) { return nullptr; }
+}
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    try { return allocate(size); } catch(...) { return nullptr; }
+}
+void operator delete(void* pointer) noexcept { release(pointer); }
+void operator delete[](void* pointer) noexcept { release(pointer); }
+void operator delete(void* pointer, size_t) noexcept { release(pointer); }
+void operator delete[](void* pointer, size_t) noexcept { release(pointer); }
+
+int main(int argc, char * argv[]) {
+    std::vector<size_t> sizes {1000, 10000, 100000, 1000000};
+    uint64_t seed = 1;
+
+    for(int argIdx = 1; argIdx < argc; argIdx++) {
+        const std::string_view arg = argv[argIdx];
+        if(arg == "--sizes" && argIdx + 1 < argc) {
+            sizes.clear();
+            std::stringstream list(argv[++argIdx]);
+            for(std::string size; std::getline(list, size, ',');)
+                sizes.push_back(std::stoul(size));
+        }
+        else if(arg == "--seed" && argIdx + 1 < argc)
+            seed = std::stoull(argv[++argIdx]);
+        else {
+            std::cout << "usage: chip8AsmBench [--sizes 1000,10000,...] [--seed n]" << std::endl;
+            return -1;
+        }
+    }
+
+    for(const size_t lines : sizes)
+    {
+        const std::string source = generateSource(lines, seed);
+
+        // small sizes are repeated for stable numbers, the fastest run of each phase is reported
+        const int repeats = int(std::clamp<size_t>(1000000 / std::max<size_t>(lines, 1), 1, 20));
+        Sample best = run(source);
+        for(int repeat = 1; repeat < repeats; repeat++) {
+            const Sample sample = run(source);
+            best.module.tokenize = std::min(best.module.tokenize, sample.module.tokenize);
+            best.module.match = std::min(best.module.match, sample.module.match);
+            best.module.emit = std::min(best.module.emit, sample.module.emit);
+            best.link = std::min(best.link, sample.link);
+        }
+
+        const double total = best.module.tokenize + best.module.match + best.module.emit + best.link;
+        char line[512];
+        std::snprintf(line, sizeof(line),
+            "{\"lines\":%zu,\"sourceBytes\":%zu,\"tokens\":%zu,\"statements\":%zu,\"romBytes\":%zu,\"ok\":%s,"
+            "\"tokenizeMs\":%.3f,\"matchMs\":%.3f,\"emitMs\":%.3f,\"linkMs\":%.3f,\"totalMs\":%.3f,\"linesPerSecond\":%.0f,"
+            "\"allocations\":%zu,\"allocationsPerLine\":%.3f,\"peakHeapBytes\":%zu,\"maxResidentKb\":%ld}",
+            lines, source.size(), best.module.tokens, best.module.statements, best.bytes, best.success ? "true" : "false",
+            best.module.tokenize * 1e3, best.module.match * 1e3, best.module.emit * 1e3, best.link * 1e3, total * 1e3,
+            total > 0 ? double(lines) / total : 0.0,
+            best.allocations, double(best.allocations) / double(std::max<size_t>(lines, 1)), best.peakBytes, maxResidentKb());
+        std::cout << line << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+// C interface of libchip8asm, for the emulator and other C callers
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct Chip8AsmResult;
+typedef struct Chip8AsmResult Chip8AsmResult;
+
+// returns the source of an included module as a malloc'd, zero terminated string (freed by the assembler), or NULL
+typedef char* (*Chip8AsmReadModule)(const char* path, void* user);
+
+// never returns NULL, check chip8asm_succeeded; readModule may be NULL when the source has no includes
+Chip8AsmResult* chip8asm_assemble(const char* source, size_t length, const char* moduleName, Chip8AsmReadModule readModule, void* user);
+void chip8asm_free(Chip8AsmResult*);
+
+bool chip8asm_succeeded(const Chip8AsmResult*);
+const uint8_t* chip8asm_bytes(const Chip8AsmResult*, size_t* size);
+
+size_t chip8asm_symbolCount(const Chip8AsmResult*);
+const char* chip8asm_symbolName(const Chip8AsmResult*, size_t idx);
+uint16_t chip8asm_symbolAddress(const Chip8AsmResult*, size_t idx);
+
+// the same bytes chip8Asm writes to the .c8map file next to the rom
+const uint8_t* chip8asm_sourceMap(const Chip8AsmResult*, size_t* size);
+
+// diagnostics formatted as "file:line: message"
+size_t chip8asm_diagnosticCount(const Chip8AsmResult*);
+const char* chip8asm_diagnostic(const Chip8AsmResult*, size_t idx);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,95 @@
+#pragma once
+
+// in-memory interface of libchip8asm: no file access, no output, no process exit
+
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// an error found while assembling or linking, collected instead of stopping the process
+struct Diagnostic
+{
+    std::string file {};
+    int line {};
+    std::string message {};
+};
+
+inline std::ostream& operator<<(std::ostream& os, const Diagnostic& in)
+{
+    if(in.file.empty())
+        return os << in.message;
+    if(in.line == 0)
+        return os << in.file << ": " << in.message;
+    return os << in.file << ":" << in.line << ": " << in.message;
+}
+
+struct AssembleOptions
+{
+    bool optimize = false;                  // same as chip8Asm -O
+    bool shrink = false;                    // same as chip8Asm -s
+    std::string moduleName {"<source>"};    // file name used in diagnostics, includes are resolved relative to it
+
+    // supplies the source of an included module; without it, include statements are reported as errors
+    std::function<bool(const std::string& path, std::string& source)> readModule {};
+};
+
+struct AssembledSymbol
+{
+    std::string name {};
+    uint16_t address {};
+};
+
+// code from address on, up to the next location, was assembled from this line
+struct SourceLocation
+{
+    uint16_t address {};
+    uint16_t file {};   // index into AssembleResult::files
+    int line {};
+};
+
+// a ;"@..." comment, bound to the first code emitted at or after its line (see estimateRoutines)
+struct Annotation
+{
+    uint16_t address {};
+    uint16_t file {};       // index into AssembleResult::files
+    int line {};
+    std::string text {};    // without the quotes, "@loop 4"
+};
+
+struct AssembleResult
+{
+    std::vector<uint8_t> bytes {};              // rom, loaded at 0x200
+    std::vector<AssembledSymbol> symbols {};    // every label in program order
+    std::vector<std::string> files {};          // modules of the program, in link order
+    std::vector<SourceLocation> locations {};   // ordered by address
+    std::vector<Annotation> annotations {};     // ordered by address
+    std::vector<Diagnostic> diagnostics {};
+
+    bool success() const { return diagnostics.empty(); }
+};
+
+AssembleResult assemble(std::string_view source, const AssembleOptions& options = {});
+
+// compact binary address -> (file, line, label) map of a result, the .c8map file loaded by the emulator
+std::vector<uint8_t> serializeSourceMap(const AssembleResult& in);
+
+// static cost of a label-delimited routine, counted in executed instructions
+struct RoutineEstimate
+{
+    std::string name {};
+    uint16_t address {};
+    size_t instructions {};     // reachable instructions from the label up to the next one, 0 for a label aliasing the previous one
+    bool called = false;        // a call target, its cost runs up to the ret
+    bool perFrame = false;      // annotated ;"@frame", its cost runs until control is back at the label
+    bool bounded = true;
+    uint64_t worstCase {};      // longest path, for called and per-frame routines that are bounded
+    std::string note {};        // why the worst case isn't bounded
+};
+
+// walks the control flow of a result: calls add the worst case of their callee, skips fork, backward jumps
+// are loops and need a bound, ;"@loop N" (body runs at most N times) or ;"@wait" (polls a timer or key, counted once);
+// misplaced or unknown annotations go to warnings
+std::vector<RoutineEstimate> estimateRoutines(const AssembleResult& in, std::vector<Diagnostic>& warnings);
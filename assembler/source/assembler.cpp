@@ -0,0 +1,578 @@
+#include "assembler.hpp"
+#include "tokenIterator.hpp"
+#include "context.hpp"
+#include "optimizer.hpp"
+#include "reducer.hpp"
+#include "linker.hpp"
+#include <vector>
+#include <cstdint>
+#include <sstream>
+#include <functional>
+#include <algorithm>
+#include <filesystem>
+#include <string_view>
+#include <chrono>
+
+// interned first, in this order, so keyword symbol ids are known up front and registers map to reg0 = 0 .. reg15 = 15
+constexpr std::string_view keywords[] = {
+    "reg0","reg1","reg2","reg3","reg4","reg5","reg6","reg7",
+    "reg8","reg9","reg10","reg11","reg12","reg13","reg14","reg15",
+    "regI","delayTimer","soundTimer","keyPress","spriteOf","bcdOf","upTo",
+    ":",";","+","*",
+    "db","cls","ret","sys","call","se","sne","ld","add","or","and","xor","sub","shr","subn","shl",
+    "jp","rnd","drw","skp","sknp",
+    "include"
+};
+
+constexpr uint32_t keywordId(std::string_view name) {
+    for(uint32_t idx = 0; idx != std::size(keywords); idx++)
+        if(keywords[idx] == name) return idx;
+    return SymbolInterner::invalidId;
+}
+
+int8_t getRegNum(uint32_t symbol) {
+    return symbol < 16 ? int8_t(symbol) : -1;
+}
+
+struct TokenMatcher
+{
+    enum class Kind { ExactLabel, ExactOperator, AnyLabel, AnyNumber, AnyNumberOrLabel, AnyGenericReg, AnyString, Any };
+
+    Kind kind;
+    uint32_t symbol {SymbolInterner::invalidId};
+
+    bool operator()(const Token::type& t) const;
+};
+
+using OutputGenerator = std::function<void(Context& context, const std::vector<Token::type>&, size_t startIdx)>;
+
+auto ExactLabel = [](std::string_view param) -> TokenMatcher  {
+    return {TokenMatcher::Kind::ExactLabel, keywordId(param)};
+};
+
+auto AnyLabel = []() -> TokenMatcher  {
+    return {TokenMatcher::Kind::AnyLabel};
+};
+
+auto ExactOperator = [](std::string_view param) -> TokenMatcher  {
+    return {TokenMatcher::Kind::ExactOperator, keywordId(param)};
+};
+
+auto AnyNumberOrLabel = []() -> TokenMatcher  {
+    return {TokenMatcher::Kind::AnyNumberOrLabel};
+};
+
+auto AnyNumber = []() -> TokenMatcher  {
+    return {TokenMatcher::Kind::AnyNumber};
+};
+
+auto Any = []() -> TokenMatcher  {
+    return {TokenMatcher::Kind::Any};
+};
+
+auto AnyGenericReg = []() -> TokenMatcher  {
+    return {TokenMatcher::Kind::AnyGenericReg};
+};
+
+auto AnyString = []() -> TokenMatcher  {
+    return {TokenMatcher::Kind::AnyString};
+};
+
+bool TokenMatcher::operator()(const Token::type& t) const
+{
+    switch(kind)
+    {
+        case Kind::ExactLabel:
+            if (const auto* typedToken = std::get_if<Token::Label>(&t))
+                return typedToken->symbol == symbol;
+            return false;
+        case Kind::ExactOperator:
+            if (const auto* typedToken = std::get_if<Token::Operator>(&t))
+                return typedToken->symbol == symbol;
+            return false;
+        case Kind::AnyLabel:
+            return std::holds_alternative<Token::Label>(t);
+        case Kind::AnyNumber:
+            return std::holds_alternative<Token::Number>(t);
+        case Kind::AnyNumberOrLabel:
+            return std::holds_alternative<Token::Label>(t) || std::holds_alternative<Token::Number>(t);
+        case Kind::AnyGenericReg:
+            if (const auto* typedToken = std::get_if<Token::Label>(&t))
+                return getRegNum(typedToken->symbol) != -1;
+            return false;
+        case Kind::AnyString:
+            return std::holds_alternative<Token::String>(t);
+        case Kind::Any:
+            return true;
+    }
+    return false;
+}
+
+auto CCCCOutput = [](uint16_t param) -> OutputGenerator  {
+    return [param](Context& context, const std::vector<Token::type>& tokens, size_t startIdx)  {
+        context.push(param, Token::lineOf(tokens[startIdx]));
+    };
+};
+
+auto ByteOutput = []() -> OutputGenerator  {
+
+    return [](Context& context, const std::vector<Token::type>& tokens, size_t startIdx) {
+
+        int value {};
+
+        if (const auto* typedToken = std::get_if<Token::Number>(&tokens[startIdx+1])) {
+            value = typedToken->value;
+        }
+        else {
+            context.error(Token::lineOf(tokens[startIdx]), "db expects a number");
+            return;
+        }
+
+        context.pushByte( uint8_t((value >> 0*8)), Token::lineOf(tokens[startIdx]) );
+    };
+};
+
+auto CNNNOutput = [](uint16_t param, int nnnIdx) -> OutputGenerator  {
+
+    return [param,nnnIdx](Context& context, const std::vector<Token::type>& tokens, size_t startIdx) {
+
+        int nnn {};
+        uint32_t symbol {SymbolInterner::invalidId};
+
+        if (const auto* typedToken = std::get_if<Token::Number>(&tokens[startIdx+nnnIdx])) {
+            nnn = typedToken->value;
+        }
+        else if (const auto* typedToken = std::get_if<Token::Label>(&tokens[startIdx+nnnIdx])) {
+            symbol = typedToken->symbol;
+        }
+        else {
+            context.error(Token::lineOf(tokens[startIdx]), "expected an address or a label");
+            return;
+        }
+
+        uint16_t out = param    | (uint8_t((nnn >> 2 * 4)) & 0b1111) << 2 * 4
+                        | (uint8_t((nnn >> 1 * 4))  & 0b1111) << 1 * 4
+                        | (uint8_t((nnn >> 0 * 4))  & 0b1111) << 0 * 4;
+
+        context.push(out, Token::lineOf(tokens[startIdx]), symbol);
+    };
+};
+
+auto CXKKOutput = [](uint16_t param) -> OutputGenerator  {
+
+    return [param](Context& context, const std::vector<Token::type>& tokens, size_t startIdx) {
+
+        int x {};
+        int kk {};
+
+        if (const auto* typedToken = std::get_if<Token::Label>(&tokens[startIdx+1])) {
+            x = getRegNum(typedToken->symbol);
+        }
+        if (const auto* typedToken = std::get_if<Token::Number>(&tokens[startIdx+2])) {
+            kk = typedToken->value;
+        }
+
+        int opcode = param | (uint8_t(x) & 0b1111) << 2 * 4
+                     | (uint8_t(kk >> 1 * 4)  & 0b1111) << 1 * 4
+                     | (uint8_t(kk >> 0 * 4)  & 0b1111) << 0 * 4;
+
+        context.push(opcode, Token::lineOf(tokens[startIdx]));
+    };
+};
+auto CXCCOutput = [](uint16_t param, uint16_t xIdx) -> OutputGenerator  {
+
+    return [param,xIdx](Context& context, const std::vector<Token::type>& tokens, size_t startIdx) {
+
+        int x {};
+
+        if (const auto* typedToken = std::get_if<Token::Label>(&tokens[startIdx+xIdx])) {
+            x = getRegNum(typedToken->symbol);
+        }
+
+        int opcode = param | (uint8_t(x) & 0b1111) << 2 * 4;
+
+        context.push(opcode, Token::lineOf(tokens[startIdx]));
+    };
+};
+
+auto CXYCOutput = [](uint16_t param) -> OutputGenerator  {
+
+    return [param](Context& context, const std::vector<Token::type>& tokens, size_t startIdx) {
+
+        int x {};
+        int y {};
+
+        if (const auto* typedToken = std::get_if<Token::Label>(&tokens[startIdx+1])) {
+            x = getRegNum(typedToken->symbol);
+        }
+        if (const auto* typedToken = std::get_if<Token::Label>(&tokens[startIdx+2])) {
+            y = getRegNum(typedToken->symbol);
+        }
+
+        int opcode = param | (uint8_t(x) & 0b1111) << 2 * 4 | (uint8_t(y) & 0b1111) << 1 * 4;
+
+        context.push(opcode, Token::lineOf(tokens[startIdx]));
+    };
+};
+
+auto CXYNOutput = [](uint16_t param) -> OutputGenerator  {
+
+    return [param](Context& context, const std::vector<Token::type>& tokens, size_t startIdx) {
+
+        int x {};
+        int y {};
+        int n {};
+
+        if (const auto* typedToken = std::get_if<Token::Label>(&tokens[startIdx+1])) {
+            x = getRegNum(typedToken->symbol);
+        }
+        if (const auto* typedToken = std::get_if<Token::Label>(&tokens[startIdx+2])) {
+            y = getRegNum(typedToken->symbol);
+        }
+        if (const auto* typedToken = std::get_if<Token::Number>(&tokens[startIdx+3])) {
+            n = typedToken->value;
+        }
+
+        int opcode = param | (uint8_t(x) & 0b1111) << 2 * 4 | (uint8_t(y) & 0b1111) << 1 * 4 | (uint8_t(n) & 0b1111) << 0 * 4;
+
+        context.push(opcode, Token::lineOf(tokens[startIdx]));
+    };
+};
+
+auto RegisterAddress = []() -> OutputGenerator  {
+    return [](Context& context, const std::vector<Token::type>& tokens, size_t startIdx) {
+        if (const auto* typedToken = std::get_if<Token::Label>(&tokens[startIdx+1])) {
+            auto& symbol = context.symbol(typedToken->symbol);
+            if( symbol.definedAtLine != 0 )
+            {
+                context.error(typedToken->line, "redefinition of label: " + std::string(typedToken->value)
+                              + " (first defined at line:" + std::to_string(symbol.definedAtLine) + ")");
+                return;
+            }
+            symbol.definedAtLine = typedToken->line;
+            context.pushLabel(typedToken->symbol, typedToken->line);
+            return;
+        }
+
+        context.error(Token::lineOf(tokens[startIdx]), "expected a label name");
+    };
+};
+
+auto IncludeModule = []() -> OutputGenerator  {
+    return [](Context& context, const std::vector<Token::type>& tokens, size_t startIdx) {
+        if (const auto* typedToken = std::get_if<Token::String>(&tokens[startIdx+1])) {
+            auto path = typedToken->value;
+            path.remove_prefix(1);
+            if(path.ends_with('"')) path.remove_suffix(1);
+            context.includes.push_back(path);
+            return;
+        }
+
+        context.error(Token::lineOf(tokens[startIdx]), "include expects a quoted path");
+    };
+};
+
+// comments are dropped, except ;"@..." ones, which are annotations for the estimator
+auto Comment = []() -> OutputGenerator  {
+    return [](Context& context, const std::vector<Token::type>& tokens, size_t startIdx) {
+        if (const auto* typedToken = std::get_if<Token::String>(&tokens[startIdx+1])) {
+            auto text = typedToken->value;
+            text.remove_prefix(1);
+            if(text.ends_with('"')) text.remove_suffix(1);
+            if(text.starts_with('@'))
+                context.annotations.push_back({0, 0, typedToken->line, std::string(text)});
+        }
+    };
+};
+
+struct OpCode
+{
+    std::vector<TokenMatcher> tokenSequence;
+    OutputGenerator generator;
+};
+
+const std::vector<OpCode> opcodes = {
+    OpCode{{ExactOperator(";"),Any()}, Comment() },
+    OpCode{ {ExactOperator(":"), AnyLabel()}, RegisterAddress() },
+    OpCode{{ExactLabel("db"),AnyNumber()}, ByteOutput() },
+    OpCode{{ExactLabel("include"),AnyString()}, IncludeModule() },
+
+    OpCode{{ExactLabel("cls")}, CCCCOutput(0x00E0) },
+    OpCode{{ExactLabel("ret")}, CCCCOutput(0x00EE) },
+    OpCode{{ExactLabel("sys"), AnyNumberOrLabel()}, CNNNOutput(0x0000,1) },
+    OpCode{{ExactLabel("call"), AnyNumberOrLabel()}, CNNNOutput(0x2000,1) },
+    OpCode{{ExactLabel("se"), AnyGenericReg(), AnyNumber()}, CXKKOutput(0x3000) },
+    OpCode{{ExactLabel("sne"), AnyGenericReg(), AnyNumber()}, CXKKOutput(0x4000) },
+    OpCode{{ExactLabel("se"), AnyGenericReg(), AnyGenericReg()}, CXYCOutput(0x5000) },
+    OpCode{{ExactLabel("ld"), AnyGenericReg(), AnyNumber()}, CXKKOutput(0x6000) },
+    OpCode{{ExactLabel("add"), AnyGenericReg(), AnyNumber()}, CXKKOutput(0x7000) },
+    OpCode{{ExactLabel("ld"), AnyGenericReg(), AnyGenericReg()}, CXYCOutput(0x8000) },
+    OpCode{{ExactLabel("or"), AnyGenericReg(), AnyGenericReg()}, CXYCOutput(0x8001) },
+    OpCode{{ExactLabel("and"), AnyGenericReg(), AnyGenericReg()}, CXYCOutput(0x8002) },
+    OpCode{{ExactLabel("xor"), AnyGenericReg(), AnyGenericReg()}, CXYCOutput(0x8003) },
+    OpCode{{ExactLabel("add"), AnyGenericReg(), AnyGenericReg()}, CXYCOutput(0x8004) },
+    OpCode{{ExactLabel("sub"), AnyGenericReg(), AnyGenericReg()}, CXYCOutput(0x8005) },
+    OpCode{{ExactLabel("shr"), AnyGenericReg(), AnyGenericReg()}, CXYCOutput(0x8006) },
+    OpCode{{ExactLabel("subn"), AnyGenericReg(), AnyGenericReg()}, CXYCOutput(0x8007) },
+    OpCode{{ExactLabel("shl"), AnyGenericReg(), AnyGenericReg()}, CXYCOutput(0x800E) },
+    OpCode{{ExactLabel("sne"), AnyGenericReg(), AnyGenericReg()}, CXYCOutput(0x9000) },
+
+    OpCode{{ExactLabel("jp"), ExactLabel("reg0"),ExactOperator("+"),AnyNumberOrLabel()}, CNNNOutput(0xB000,3) },
+    OpCode{{ExactLabel("jp"), AnyNumberOrLabel()}, CNNNOutput(0x1000,1) },
+
+    OpCode{{ExactLabel("rnd"), AnyGenericReg(), AnyNumber()}, CXKKOutput(0xC000) },
+    OpCode{{ExactLabel("drw"), AnyGenericReg(),AnyGenericReg(), AnyNumber()}, CXYNOutput(0xD000) },
+
+    OpCode{{ExactLabel("skp"), AnyGenericReg()}, CXCCOutput( 0xE09E,1 ) },
+    OpCode{{ExactLabel("sknp"), AnyGenericReg()}, CXCCOutput( 0xE0A1,1 ) },
+    OpCode{{ExactLabel("ld"), AnyGenericReg(),ExactLabel("delayTimer")}, CXCCOutput( 0xF007,1 ) },
+    OpCode{{ExactLabel("ld"), AnyGenericReg(),ExactLabel("keyPress")}, CXCCOutput( 0xF00A,1) },
+
+    OpCode{{ExactLabel("ld"), ExactLabel("delayTimer"),AnyGenericReg()}, CXCCOutput( 0xF015,2 ) },
+    OpCode{{ExactLabel("ld"), ExactLabel("soundTimer"),AnyGenericReg()}, CXCCOutput( 0xF018,2 ) },
+
+    OpCode{{ExactLabel("add"), ExactLabel("regI"),AnyGenericReg()}, CXCCOutput( 0xF01E, 2 ) },
+    OpCode{{ExactLabel("ld"), ExactLabel("regI"),ExactLabel("spriteOf"),AnyGenericReg()}, CXCCOutput( 0xF029,3) },
+    OpCode{{ExactLabel("ld"), ExactLabel("regI"),AnyNumberOrLabel()}, CNNNOutput(0xA000,2) },
+    OpCode{{ExactLabel("ld"), ExactOperator("*"),ExactLabel("regI"),ExactLabel("bcdOf"),AnyGenericReg()}, CXCCOutput( 0xF033,4 ) },
+    OpCode{{ExactLabel("ld"), ExactOperator("*"),ExactLabel("regI"),ExactLabel("upTo"), AnyGenericReg()}, CXCCOutput( 0xF055,4 ) },
+    OpCode{{ExactLabel("ld"), ExactLabel("upTo"), AnyGenericReg(), ExactOperator("*"),ExactLabel("regI")}, CXCCOutput( 0xF065,2 ) }
+};
+
+// every form starts with an exact mnemonic (keyword label or operator), so forms are grouped by its symbol id once
+// and a statement only tests the few forms sharing its mnemonic, in the order of the table above
+class OpCodeIndex
+{
+public:
+    explicit OpCodeIndex(const std::vector<OpCode>& inOpcodes) : bySymbol(std::size(keywords))
+    {
+        for(const auto& opcode : inOpcodes)
+            bySymbol[opcode.tokenSequence.front().symbol].push_back(&opcode);
+    }
+
+    const OpCode* match(const std::vector<Token::type>& tokens, size_t startIdx) const
+    {
+        uint32_t mnemonic {SymbolInterner::invalidId};
+        if (const auto* typedToken = std::get_if<Token::Label>(&tokens[startIdx]))
+            mnemonic = typedToken->symbol;
+        else if (const auto* typedToken = std::get_if<Token::Operator>(&tokens[startIdx]))
+            mnemonic = typedToken->symbol;
+
+        if(mnemonic >= bySymbol.size())
+            return nullptr;
+
+        for(const OpCode* opcode : bySymbol[mnemonic])
+        {
+            const auto& sequence = opcode->tokenSequence;
+            if(startIdx + sequence.size() > tokens.size())
+                continue;
+
+            bool success = true;
+            for(size_t matcherIdx = 1; matcherIdx != sequence.size(); matcherIdx++)
+            {
+                if(!sequence[matcherIdx](tokens[startIdx + matcherIdx])) {
+                    success = false;
+                    break;
+                }
+            }
+
+            if(success)
+                return opcode;
+        }
+        return nullptr;
+    }
+
+protected:
+    std::vector<std::vector<const OpCode*>> bySymbol {};
+};
+
+
+bool assembleModule(std::string_view source, const std::string& moduleName, ObjectFile& out, std::vector<Diagnostic>& diagnostics, ModuleTimings* timings)
+{
+    using Clock = std::chrono::steady_clock;
+    const auto tokenizeStart = Clock::now();
+
+    Context context;
+    context.moduleName = moduleName;
+    SymbolInterner symbols;
+    for(auto keyword : keywords)
+        symbols.intern(keyword);
+
+    TokenIterator it(source, symbols);
+    it.addOperator(":");
+    it.addOperator(";");
+    it.addOperator("+");
+    it.addOperator("*");
+
+    std::vector<Token::type> tokens {};
+    size_t consumedIndex = 0;
+
+    while(!std::holds_alternative<Token::End>(it.next()))
+    {
+        if(const auto* typedToken = std::get_if<Token::Number>(&it.current()); typedToken && typedToken->tooLarge)
+            context.error(typedToken->line, "number too large: " + std::string(typedToken->text) + ", at most 0xFFFF");
+        tokens.push_back(it.current());
+    }
+
+    // statements are matched first and emitted after, so each phase runs as one tight loop
+    const auto matchStart = Clock::now();
+    struct Statement {
+        const OpCode* opcode;
+        size_t startIdx;
+    };
+    std::vector<Statement> statements {};
+    statements.reserve(tokens.size() / 2);
+
+    static const OpCodeIndex opcodeIndex(opcodes); // shared read-only by concurrent jobs
+    while(consumedIndex < tokens.size())
+    {
+        const OpCode* opcode = opcodeIndex.match(tokens, consumedIndex);
+        if(!opcode)
+            break;
+
+        statements.push_back({opcode, consumedIndex});
+        consumedIndex += opcode->tokenSequence.size();
+    }
+
+    const auto emitStart = Clock::now();
+    context.program.reserve(statements.size());
+    for(const auto& statement : statements)
+        statement.opcode->generator(context, tokens, statement.startIdx);
+
+    if(consumedIndex < tokens.size()) {
+        std::ostringstream message;
+        message << "couldn't consume next opcode, starting at:" << tokens[consumedIndex];
+        context.error(Token::lineOf(tokens[consumedIndex]), message.str());
+    }
+
+    if(timings) {
+        const auto emitEnd = Clock::now();
+        timings->tokenize += std::chrono::duration<double>(matchStart - tokenizeStart).count();
+        timings->match += std::chrono::duration<double>(emitStart - matchStart).count();
+        timings->emit += std::chrono::duration<double>(emitEnd - emitStart).count();
+        timings->tokens += tokens.size();
+        timings->statements += statements.size();
+    }
+
+    if(!context.diagnostics.empty()) {
+        diagnostics.insert(diagnostics.end(), context.diagnostics.begin(), context.diagnostics.end());
+        return false;
+    }
+
+    out = {};
+    out.moduleName = moduleName;
+
+    const auto moduleDirectory = std::filesystem::path(moduleName).parent_path();
+    for(auto include : context.includes)
+        out.includes.push_back((moduleDirectory / include).lexically_normal().string());
+
+    // interner ids to a dense module symbol table
+    std::vector<uint32_t> localIds(symbols.size(), SymbolInterner::invalidId);
+    out.program = std::move(context.program);
+    out.annotations = std::move(context.annotations);
+    for(auto& item : out.program)
+    {
+        if(item.symbol == SymbolInterner::invalidId)
+            continue;
+        if(localIds[item.symbol] == SymbolInterner::invalidId) {
+            localIds[item.symbol] = uint32_t(out.symbols.size());
+            out.symbols.emplace_back(symbols.name(item.symbol));
+        }
+        item.symbol = localIds[item.symbol];
+    }
+    return true;
+}
+
+bool linkProgram(const std::vector<ObjectFile>& objects, const AssembleOptions& options, AssembleResult& out, std::ostream* log)
+{
+    Context context;
+    SymbolInterner names;
+    if(!linkObjects(objects, context, names)) {
+        out.diagnostics.insert(out.diagnostics.end(), context.diagnostics.begin(), context.diagnostics.end());
+        return false;
+    }
+
+    if(options.optimize) {
+        const auto report = optimize(context.program);
+        if(log) *log << report << std::endl;
+    }
+    if(options.shrink) {
+        const auto report = reduce(context.program);
+        if(log) *log << report << std::endl;
+    }
+
+    if(log) *log << "linking symbols" << std::endl;
+
+    if(!link(context, names)) {
+        out.diagnostics.insert(out.diagnostics.end(), context.diagnostics.begin(), context.diagnostics.end());
+        return false;
+    }
+
+    out.bytes = std::move(context.output);
+    out.files.assign(context.files.begin(), context.files.end());
+
+    uint16_t address = 0x200;
+    std::vector<uint16_t> addresses;
+    addresses.reserve(context.program.size());
+    for(const auto& item : context.program) {
+        addresses.push_back(address);
+        if(item.isLabel()) {
+            out.symbols.push_back({std::string(names.name(item.symbol)), uint16_t(context.symbols[item.symbol].targetLocation)});
+            continue;
+        }
+        // one location per run of bytes coming from the same line
+        if(out.locations.empty() || out.locations.back().file != item.file || out.locations.back().line != item.line)
+            out.locations.push_back({address, item.file, item.line});
+        address += item.size();
+    }
+
+    // an annotation belongs to the first code or data at or after its line, comments trailing a statement to that statement
+    for(auto annotation : context.annotations) {
+        for(size_t itemIdx = 0; itemIdx != context.program.size(); itemIdx++) {
+            const auto& item = context.program[itemIdx];
+            if(!item.isLabel() && item.file == annotation.file && item.line >= annotation.line) {
+                annotation.address = addresses[itemIdx];
+                out.annotations.push_back(std::move(annotation));
+                break;
+            }
+        }
+    }
+    std::stable_sort(out.annotations.begin(), out.annotations.end(), [](const Annotation& a, const Annotation& b) { return a.address < b.address; });
+    return true;
+}
+
+AssembleResult assemble(std::string_view source, const AssembleOptions& options)
+{
+    AssembleResult result;
+
+    // the root module, then its includes breadth first, each module once
+    std::vector<ObjectFile> objects(1);
+    if(!assembleModule(source, options.moduleName, objects.front(), result.diagnostics))
+        return result;
+
+    std::vector<std::string> seen {options.moduleName};
+    for(size_t objectIdx = 0; objectIdx != objects.size(); objectIdx++)
+    {
+        const auto includes = objects[objectIdx].includes;
+        for(const auto& path : includes)
+        {
+            if(std::find(seen.begin(), seen.end(), path) != seen.end())
+                continue;
+            seen.push_back(path);
+
+            std::string included;
+            if(!options.readModule || !options.readModule(path, included)) {
+                result.diagnostics.push_back({objects[objectIdx].moduleName, 0, "couldn't read included module " + path});
+                continue;
+            }
+
+            ObjectFile object;
+            if(assembleModule(included, path, object, result.diagnostics))
+                objects.push_back(std::move(object));
+        }
+    }
+
+    if(result.success())
+        linkProgram(objects, options, result);
+    return result;
+}
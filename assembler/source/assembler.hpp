@@ -0,0 +1,26 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "chip8asm.hpp"
+#include "objectFile.hpp"
+
+// time spent in each phase of assembleModule, in seconds, accumulated over calls
+struct ModuleTimings
+{
+    double tokenize {};
+    double match {};
+    double emit {};     // output generators
+    size_t tokens {};
+    size_t statements {};
+};
+
+// assembles a single module into a relocatable object, labels stay symbolic until linking;
+// errors go to diagnostics and assembly stops at the first statement that matches no opcode
+bool assembleModule(std::string_view source, const std::string& moduleName, ObjectFile& out, std::vector<Diagnostic>& diagnostics, ModuleTimings* timings = nullptr);
+
+// links modules in order, runs the requested passes and fills bytes and symbols of out,
+// pass reports and progress go to log when one is given
+bool linkProgram(const std::vector<ObjectFile>& objects, const AssembleOptions& options, AssembleResult& out, std::ostream* log = nullptr);
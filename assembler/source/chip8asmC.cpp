@@ -0,0 +1,88 @@
+#include "chip8asm.h"
+#include "chip8asm.hpp"
+#include <cstdlib>
+#include <sstream>
+
+struct Chip8AsmResult
+{
+    AssembleResult result {};
+    std::vector<std::string> diagnostics {}; // formatted once, so returned pointers stay valid
+    std::vector<uint8_t> sourceMap {};
+};
+
+Chip8AsmResult* chip8asm_assemble(const char* source, size_t length, const char* moduleName, Chip8AsmReadModule readModule, void* user)
+{
+    AssembleOptions options;
+    if(moduleName)
+        options.moduleName = moduleName;
+    if(readModule) {
+        options.readModule = [readModule, user](const std::string& path, std::string& out) {
+            char* text = readModule(path.c_str(), user);
+            if(!text)
+                return false;
+            out = text;
+            std::free(text);
+            return true;
+        };
+    }
+
+    auto* out = new Chip8AsmResult;
+    out->result = assemble({source, length}, options);
+    for(const auto& diagnostic : out->result.diagnostics) {
+        std::ostringstream text;
+        text << diagnostic;
+        out->diagnostics.push_back(text.str());
+    }
+    if(out->result.success())
+        out->sourceMap = serializeSourceMap(out->result);
+    return out;
+}
+
+void chip8asm_free(Chip8AsmResult* in)
+{
+    delete in;
+}
+
+bool chip8asm_succeeded(const Chip8AsmResult* in)
+{
+    return in->result.success();
+}
+
+const uint8_t* chip8asm_bytes(const Chip8AsmResult* in, size_t* size)
+{
+    if(size)
+        *size = in->result.bytes.size();
+    return in->result.bytes.data();
+}
+
+size_t chip8asm_symbolCount(const Chip8AsmResult* in)
+{
+    return in->result.symbols.size();
+}
+
+const char* chip8asm_symbolName(const Chip8AsmResult* in, size_t idx)
+{
+    return in->result.symbols[idx].name.c_str();
+}
+
+uint16_t chip8asm_symbolAddress(const Chip8AsmResult* in, size_t idx)
+{
+    return in->result.symbols[idx].address;
+}
+
+const uint8_t* chip8asm_sourceMap(const Chip8AsmResult* in, size_t* size)
+{
+    if(size)
+        *size = in->sourceMap.size();
+    return in->sourceMap.data();
+}
+
+size_t chip8asm_diagnosticCount(const Chip8AsmResult* in)
+{
+    return in->diagnostics.size();
+}
+
+const char* chip8asm_diagnostic(const Chip8AsmResult* in, size_t idx)
+{
+    return in->diagnostics[idx].c_str();
+}
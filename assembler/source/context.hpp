@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "symbolInterner.hpp"
+#include "chip8asm.hpp"
+
+// one element of the emitted program, kept symbolic until linking so passes can still rearrange it
+struct Emitted
+{
+    enum class Kind : uint8_t { Instruction, Byte, Label };
+
+    Kind kind {};
+    uint16_t value {};                              // opcode or byte, nnn is left empty when symbol is set
+    uint16_t file {};                               // module it came from, index into Context::files
+    uint32_t symbol {SymbolInterner::invalidId};    // label defined here, or label patched into nnn of the opcode
+    int line {};
+
+    bool isInstruction() const { return kind == Kind::Instruction; }
+    bool isLabel() const { return kind == Kind::Label; }
+    uint16_t size() const { return kind == Kind::Instruction ? 2 : kind == Kind::Byte ? 1 : 0; }
+};
+
+struct Context
+{
+    std::vector<Emitted> program {};
+
+    void push(uint16_t in, int line, uint32_t symbol = SymbolInterner::invalidId) {
+        program.push_back({Emitted::Kind::Instruction, in, 0, symbol, line});
+    }
+    void pushByte(uint8_t in, int line) {
+        program.push_back({Emitted::Kind::Byte, in, 0, SymbolInterner::invalidId, line});
+    }
+    void pushLabel(uint32_t symbol, int line) {
+        program.push_back({Emitted::Kind::Label, 0, 0, symbol, line});
+    }
+
+    std::vector<std::string_view> includes {};  // modules requested by include "path", as written
+    std::vector<std::string_view> files {};     // module names of a linked program
+    std::vector<Annotation> annotations {};     // ;"@..." comments, addresses are assigned by linkProgram
+
+    // indexed by interned symbol id, grown on demand
+    struct Symbol {
+        int targetLocation {-1};
+        int definedAtLine {};
+        uint16_t definedInFile {};
+    };
+
+    // all label uses in emission order, patched in one pass when linking
+    struct Fixup {
+        uint32_t symbol {};
+        uint32_t outputIdx {};
+        int line {};
+        uint16_t file {};
+    };
+
+    std::vector<Symbol> symbols {};
+    std::vector<Fixup> fixups {};
+    std::vector<uint8_t> output {};
+
+    std::string_view moduleName {};             // module being assembled, for diagnostics
+    std::vector<Diagnostic> diagnostics {};
+
+    void error(std::string_view file, int line, std::string message) {
+        diagnostics.push_back({std::string(file), line, std::move(message)});
+    }
+    void error(int line, std::string message) {
+        error(moduleName, line, std::move(message));
+    }
+
+    Symbol& symbol(uint32_t id) {
+        if(id >= symbols.size())
+            symbols.resize(id + 1);
+        return symbols[id];
+    }
+};
@@ -0,0 +1,312 @@
+#include "chip8asm.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+// worst case of a routine is its longest path through the control flow graph, in instructions:
+//   ret ends a path, call costs 1 + the worst case of the callee, a skip forks to the next two instructions,
+//   an annotated backward jump (the loop tail) is not followed, its head instead adds (N - 1) times the
+//   longest head to tail path of the body, so N iterations are counted in total
+// any other cycle, recursion or a computed jump (jp reg0 + nnn) makes the routine unbounded
+
+namespace
+{
+    constexpr int64_t unbounded = std::numeric_limits<int64_t>::max();
+    constexpr int64_t unreachable = -1;     // no path to the walk target
+
+    int64_t sum(int64_t a, int64_t b) {
+        if(a == unreachable || b == unreachable) return unreachable;
+        if(a == unbounded || b == unbounded || a > unbounded - b) return unbounded;
+        return a + b;
+    }
+
+    int64_t product(int64_t a, int64_t count) {
+        if(a == unbounded) return count == 0 ? 0 : unbounded;
+        if(a == unreachable || count == 0) return 0;
+        return a > unbounded / count ? unbounded : a * count;
+    }
+
+    class Estimator
+    {
+    public:
+        Estimator(const AssembleResult& inResult, std::vector<Diagnostic>& inWarnings) : result(inResult), warnings(inWarnings)
+        {
+            for(const auto& annotation : result.annotations)
+                bind(annotation);
+        }
+
+        bool isCode(uint16_t address) const {
+            return address >= 0x200 && size_t(address - 0x200 + 1) < result.bytes.size();
+        }
+
+        uint16_t opcodeAt(uint16_t address) const {
+            return uint16_t(result.bytes[address - 0x200] << 8 | result.bytes[address - 0x200 + 1]);
+        }
+
+        // flow successors, annotated loop tails don't return to their head
+        std::vector<uint16_t> successors(uint16_t address, bool followLoops) const
+        {
+            const uint16_t opcode = opcodeAt(address);
+            const uint16_t nnn = opcode & 0x0FFF;
+            switch(opcode & 0xF000) {
+                case 0x0000: if(opcode == 0x00EE) return {}; break;
+                case 0x1000: return followLoops || !loopBounds.contains(address) ? std::vector<uint16_t>{nnn} : std::vector<uint16_t>{};
+                case 0xB000: return {};
+                case 0x3000: case 0x4000: case 0x5000: case 0x9000: return {uint16_t(address + 2), uint16_t(address + 4)};
+                case 0xE000:
+                    if((opcode & 0x00FF) == 0x9E || (opcode & 0x00FF) == 0xA1)
+                        return {uint16_t(address + 2), uint16_t(address + 4)};
+                    break;
+            }
+            return {uint16_t(address + 2)};
+        }
+
+        // instructions reachable from 0x200, every call target and every frame entry, data is never visited
+        std::vector<bool> reachable()
+        {
+            std::vector<bool> visited(0x1000);
+            std::vector<uint16_t> pending {0x200};
+            for(auto entry : frameEntries)
+                pending.push_back(entry);
+
+            while(!pending.empty()) {
+                const uint16_t address = pending.back();
+                pending.pop_back();
+                if(address >= visited.size() || visited[address] || !isCode(address))
+                    continue;
+                visited[address] = true;
+
+                const uint16_t opcode = opcodeAt(address);
+                if((opcode & 0xF000) == 0x2000) {
+                    callTargets.push_back(opcode & 0x0FFF);
+                    pending.push_back(opcode & 0x0FFF);
+                }
+                for(auto next : successors(address, true))
+                    pending.push_back(next);
+            }
+            return visited;
+        }
+
+        int64_t routine(uint16_t entry, std::string& note)
+        {
+            reason.clear();
+            const int64_t cost = callee(entry);
+            note = reason;
+            return cost;
+        }
+
+        int64_t frame(uint16_t entry, std::string& note)
+        {
+            reason.clear();
+            Walk walk;
+            walk.stop = entry;
+            const int64_t cost = longest(walk, entry);
+            note = reason;
+            return cost;
+        }
+
+        std::vector<uint16_t> frameEntries {};
+        std::vector<uint16_t> callTargets {};
+
+    protected:
+        // one longest path query; body walks stay within a loop and end at its tail
+        struct Walk {
+            uint16_t low {0x200};
+            uint16_t high {0xFFF};
+            int target {-1};    // path must end here (a loop tail)
+            int stop {-1};      // reaching it ends the path at no cost (a frame entry)
+            int loopHead {-1};  // the loop a body walk measures, not expanded again
+            std::map<uint16_t, int64_t> done {};
+            std::vector<uint16_t> visiting {};
+        };
+
+        struct Routine {
+            int64_t cost {};
+            std::string reason {};
+        };
+
+        void fail(std::string message) {
+            if(reason.empty())
+                reason = std::move(message);
+        }
+
+        std::string describe(uint16_t address) const
+        {
+            auto location = std::upper_bound(result.locations.begin(), result.locations.end(), address,
+                                             [](uint16_t value, const SourceLocation& in) { return value < in.address; });
+            char hex[8];
+            std::snprintf(hex, sizeof(hex), "0x%03x", address);
+            if(location == result.locations.begin())
+                return hex;
+            --location;
+            return result.files[location->file] + ":" + std::to_string(location->line) + " (" + hex + ")";
+        }
+
+        void bind(const Annotation& annotation)
+        {
+            const std::string_view text = annotation.text;
+            const auto warn = [&](std::string message) {
+                warnings.push_back({result.files[annotation.file], annotation.line, std::move(message)});
+            };
+
+            if(text == "@frame") {
+                frameEntries.push_back(annotation.address);
+                return;
+            }
+
+            int64_t iterations = 1;
+            if(text.starts_with("@loop ")) {
+                const auto digits = text.substr(6);
+                if(std::from_chars(digits.data(), digits.data() + digits.size(), iterations).ec != std::errc() || iterations < 1) {
+                    warn("@loop expects a positive iteration count");
+                    return;
+                }
+            }
+            else if(text != "@wait") {
+                warn("unknown annotation " + std::string(text));
+                return;
+            }
+
+            const bool backwardJump = isCode(annotation.address) && (opcodeAt(annotation.address) & 0xF000) == 0x1000
+                                      && (opcodeAt(annotation.address) & 0x0FFF) <= annotation.address;
+            if(!backwardJump) {
+                warn(std::string(text.substr(0, text.find(' '))) + " must annotate a backward jp, the tail of a loop");
+                return;
+            }
+            loopBounds[annotation.address] = iterations;
+            loopTails[opcodeAt(annotation.address) & 0x0FFF].push_back(annotation.address);
+        }
+
+        int64_t callee(uint16_t entry)
+        {
+            if(const auto known = routines.find(entry); known != routines.end()) {
+                if(known->second.cost == unbounded)
+                    fail(known->second.reason);
+                return known->second.cost;
+            }
+            if(std::find(calling.begin(), calling.end(), entry) != calling.end()) {
+                fail("recursive call to " + describe(entry));
+                return unbounded;
+            }
+
+            calling.push_back(entry);
+            const std::string outerReason = std::exchange(reason, {});
+            Walk walk;
+            int64_t cost = longest(walk, entry);
+            if(cost == unreachable) cost = 0;
+            routines[entry] = {cost, reason};
+            calling.pop_back();
+
+            if(!outerReason.empty())
+                reason = outerReason;   // the first reason found wins, otherwise the one of the callee is kept
+            return cost;
+        }
+
+        int64_t longest(Walk& walk, uint16_t address)
+        {
+            if(!isCode(address))
+                return walk.target == -1 ? 0 : unreachable;   // ran off the program
+            if(const auto known = walk.done.find(address); known != walk.done.end())
+                return known->second;
+            if(std::find(walk.visiting.begin(), walk.visiting.end(), address) != walk.visiting.end()) {
+                fail("loop without a bound back to " + describe(address) + ", annotate its jp with ;\"@loop N\" or ;\"@wait\"");
+                return unbounded;
+            }
+            walk.visiting.push_back(address);
+
+            const uint16_t opcode = opcodeAt(address);
+            int64_t cost = 1;
+            if((opcode & 0xF000) == 0x2000)
+                cost = sum(cost, callee(opcode & 0x0FFF));
+            if((opcode & 0xF000) == 0xB000) {
+                fail("computed jump at " + describe(address));
+                cost = unbounded;
+            }
+
+            // a loop starting here: the path below counts one pass of the body, the others are added up front
+            if(const auto loops = loopTails.find(address); loops != loopTails.end() && walk.loopHead != address) {
+                for(auto tail : loops->second) {
+                    Walk body;
+                    body.low = address;
+                    body.high = tail;
+                    body.target = tail;
+                    body.loopHead = address;
+                    cost = sum(cost, product(longest(body, address), loopBounds[tail] - 1));
+                }
+            }
+
+            int64_t rest = unreachable;
+            if(address == walk.target)
+                rest = 0;
+            else {
+                const auto next = successors(address, false);
+                if(next.empty() && walk.target == -1)
+                    rest = 0;
+                for(auto nextAddress : next) {
+                    if(nextAddress < walk.low || nextAddress > walk.high)
+                        continue;
+                    rest = std::max(rest, nextAddress == walk.stop ? 0 : longest(walk, nextAddress));
+                }
+            }
+
+            walk.visiting.pop_back();
+            const int64_t total = sum(cost, rest);
+            walk.done[address] = total;
+            return total;
+        }
+
+        const AssembleResult& result;
+        std::vector<Diagnostic>& warnings;
+        std::map<uint16_t, int64_t> loopBounds {};                  // loop tail -> iterations
+        std::map<uint16_t, std::vector<uint16_t>> loopTails {};     // loop head -> its tails
+        std::map<uint16_t, Routine> routines {};
+        std::vector<uint16_t> calling {};
+        std::string reason {};
+    };
+}
+
+std::vector<RoutineEstimate> estimateRoutines(const AssembleResult& in, std::vector<Diagnostic>& warnings)
+{
+    Estimator estimator(in, warnings);
+    const auto reachable = estimator.reachable();
+
+    std::vector<RoutineEstimate> out;
+    for(size_t symbolIdx = 0; symbolIdx != in.symbols.size(); symbolIdx++)
+    {
+        const auto& symbol = in.symbols[symbolIdx];
+        RoutineEstimate routine;
+        routine.name = symbol.name;
+        routine.address = symbol.address;
+
+        // labels sharing an address are one routine, reported under the first of them
+        const bool alias = symbolIdx != 0 && in.symbols[symbolIdx - 1].address == symbol.address;
+        size_t end = reachable.size();
+        for(size_t nextIdx = symbolIdx + 1; nextIdx != in.symbols.size(); nextIdx++) {
+            if(in.symbols[nextIdx].address != symbol.address) {
+                end = in.symbols[nextIdx].address;
+                break;
+            }
+        }
+        for(size_t address = symbol.address; !alias && address < end && address < reachable.size(); address++)
+            routine.instructions += reachable[address];
+
+        const auto& frames = estimator.frameEntries;
+        const auto& calls = estimator.callTargets;
+        routine.perFrame = !alias && std::find(frames.begin(), frames.end(), symbol.address) != frames.end();
+        routine.called = !alias && std::find(calls.begin(), calls.end(), symbol.address) != calls.end();
+
+        if(routine.perFrame || routine.called) {
+            const int64_t cost = routine.perFrame ? estimator.frame(symbol.address, routine.note) : estimator.routine(symbol.address, routine.note);
+            routine.bounded = cost != unbounded;
+            routine.worstCase = routine.bounded ? uint64_t(std::max<int64_t>(cost, 0)) : 0;
+        }
+        out.push_back(std::move(routine));
+    }
+    return out;
+}
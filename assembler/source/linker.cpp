@@ -0,0 +1,99 @@
+#include "linker.hpp"
+#include <string>
+
+namespace
+{
+    std::string_view fileName(const Context& context, uint16_t file)
+    {
+        return file < context.files.size() ? context.files[file] : std::string_view("<source>");
+    }
+}
+
+bool linkObjects(const std::vector<ObjectFile>& objects, Context& context, SymbolInterner& names)
+{
+    bool success = true;
+    std::vector<uint32_t> localToGlobal;
+
+    context.program.clear();
+    context.annotations.clear();
+    for(size_t objectIdx = 0; objectIdx != objects.size(); objectIdx++)
+    {
+        const auto& object = objects[objectIdx];
+        const auto file = uint16_t(context.files.size());
+        context.files.push_back(object.moduleName);
+
+        localToGlobal.clear();
+        for(const auto& name : object.symbols)
+            localToGlobal.push_back(names.intern(name));
+
+        for(auto item : object.program)
+        {
+            item.file = file;
+            if(item.symbol != SymbolInterner::invalidId)
+                item.symbol = localToGlobal[item.symbol];
+
+            if(item.isLabel()) {
+                auto& symbol = context.symbol(item.symbol);
+                if(symbol.definedAtLine != 0) {
+                    context.error(object.moduleName, item.line, "redefinition of label: " + std::string(names.name(item.symbol))
+                                  + " (first defined at line:" + std::to_string(symbol.definedAtLine) + " of " + std::string(fileName(context, symbol.definedInFile)) + ")");
+                    success = false;
+                    continue;
+                }
+                symbol.definedAtLine = item.line;
+                symbol.definedInFile = file;
+            }
+            context.program.push_back(item);
+        }
+
+        for(auto annotation : object.annotations) {
+            annotation.file = file;
+            context.annotations.push_back(std::move(annotation));
+        }
+    }
+    return success;
+}
+
+bool link(Context& context, const SymbolInterner& names)
+{
+    if(context.symbols.size() < names.size())
+        context.symbols.resize(names.size()); // every interned id gets a slot, lookups below need no bounds checks
+    std::vector<bool> reported(context.symbols.size());
+    bool success = true;
+
+    context.output.clear();
+    context.fixups.clear();
+    for(const auto& item : context.program)
+    {
+        if(item.kind == Emitted::Kind::Label) {
+            context.symbols[item.symbol].targetLocation = 0x200 + context.output.size();
+        }
+        else if(item.kind == Emitted::Kind::Byte) {
+            context.output.push_back(uint8_t(item.value));
+        }
+        else {
+            if(item.symbol != SymbolInterner::invalidId)
+                context.fixups.push_back({item.symbol, uint32_t(context.output.size()), item.line, item.file});
+            context.output.push_back( uint8_t((item.value >> 1*8)) );
+            context.output.push_back( uint8_t((item.value >> 0*8)) );
+        }
+    }
+
+    for(const auto& fixup : context.fixups)
+    {
+        const int targetLocation = context.symbols[fixup.symbol].targetLocation;
+        if(targetLocation == -1) {
+            if(!reported[fixup.symbol])
+                context.error(fileName(context, fixup.file), fixup.line, "symbol " + std::string(names.name(fixup.symbol)) + " was used, but not defined");
+            reported[fixup.symbol] = true;
+            success = false;
+            continue;
+        }
+
+        auto& output = context.output;
+        output[fixup.outputIdx] = (output[fixup.outputIdx] & 0b11110000) | (targetLocation >> 2 * 4 & 0b1111);
+        output[fixup.outputIdx+1] = targetLocation;
+    }
+    return success;
+}
+
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <vector>
+#include "context.hpp"
+#include "objectFile.hpp"
+
+// concatenates modules, in order, into context.program and resolves their symbol tables through names,
+// objects are referenced by the interner and must outlive it; labels defined in more than one module are added to context.diagnostics
+bool linkObjects(const std::vector<ObjectFile>& objects, Context& context, SymbolInterner& names);
+
+// lays the program out from 0x200, then patches every fixup in a single pass,
+// each undefined symbol is diagnosed once (at its first use) instead of stopping
+bool link(Context& context, const SymbolInterner& names);
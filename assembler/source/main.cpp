@@ -3,401 +3,413 @@
 #include <cstdint>
 #include <sstream>
 #include <fstream>
-#include <map>
-#include <functional>
-#include <queue>
-#include "tokenIterator.hpp"
-
-struct Context
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <cstdlib>
+#include <span>
+#include <string_view>
+#include <iomanip>
+#include "assembler.hpp"
+#include "objectFile.hpp"
+#include "memoryImage.hpp"
+
+bool readFile(const std::string& path, std::string& out)
 {
-    std::vector<uint8_t> output;
-    void push(uint16_t in) {
-        output.push_back( uint8_t((in >> 1*8)) );
-        output.push_back( uint8_t((in >> 0*8)) );
-    }
-
-    struct addrRef {
-        int targetLocation {-1};
-        std::vector<int> addressToPut {};
-    };
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    if(!file.good())
+        return false;
 
-    std::map<std::string,addrRef> addrRefs {};
-};
+    std::stringstream stream{};
+    stream << file.rdbuf();
+    out = stream.str();
+    return true;
+}
 
-using TokenMatcher = std::function<bool(Token::type&)>;
-using OutputGenerator = std::function<void(Context& context, std::vector<Token::type>, size_t startIdx)>;
+bool writeFile(const std::string& path, std::span<const uint8_t> in)
+{
+    std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(in.data()), std::streamsize(in.size()));
+    return file.good();
+}
 
-auto ExactLabel = [](std::string param) -> TokenMatcher  {
-    return [param](Token::type& t) -> bool {
-        if (const auto* typedToken = std::get_if<Token::Label>(&t)) {
-            return typedToken->value == param;
-        }
+// cache entries are written under a per-thread name and renamed into place,
+// so jobs assembling the same module concurrently never see a half written object
+bool writeFileAtomic(const std::string& path, std::span<const uint8_t> in)
+{
+    const auto threadTag = std::hash<std::thread::id>{}(std::this_thread::get_id());
+    const std::string temporaryPath = path + "." + std::to_string(threadTag) + ".tmp";
+    if(!writeFile(temporaryPath, in))
         return false;
-    };
-};
 
+    std::error_code error;
+    std::filesystem::rename(temporaryPath, path, error);
+    if(error)
+        std::filesystem::remove(temporaryPath, error);
+    return !error;
+}
 
-auto AnyLabel = []() -> TokenMatcher  {
-    return [](Token::type& t) -> bool {
-        if (const auto* typedToken = std::get_if<Token::Label>(&t)) {
-            return true;
-        }
-        return false;
-    };
-};
-
-auto ExactOperator = [](std::string param) -> TokenMatcher  {
-    return [param](Token::type& t) -> bool {
-        if (const auto* typedToken = std::get_if<Token::Operator>(&t)) {
-            return typedToken->value == param;
-        }
+// a module is re-assembled only when its content hash has no object in the cache yet
+bool loadModule(const std::string& path, const std::string& cacheDirectory, ObjectFile& out, std::ostream& log, std::vector<Diagnostic>& diagnostics)
+{
+    std::string source;
+    if(!readFile(path, source)) {
+        diagnostics.push_back({path, 0, "couldn't open file"});
         return false;
-    };
-};
+    }
 
-auto AnyNumberOrLabel = []() -> TokenMatcher  {
-    return [](Token::type& t) -> bool {
-        if (const auto* typedToken = std::get_if<Token::Label>(&t)) {
-            return true;
-        }
-        if (const auto* typedToken = std::get_if<Token::Number>(&t)) {
+    const uint64_t sourceHash = hashSource(source, path);
+    std::string cachePath;
+    if(!cacheDirectory.empty())
+    {
+        char hashName[17] {};
+        std::snprintf(hashName, sizeof(hashName), "%016llx", (unsigned long long)sourceHash);
+        cachePath = (std::filesystem::path(cacheDirectory) / (std::string(hashName) + ".c8o")).string();
+
+        std::string cached;
+        if(readFile(cachePath, cached)
+           && ObjectFile::deserialize({reinterpret_cast<const uint8_t*>(cached.data()), cached.size()}, out)
+           && out.sourceHash == sourceHash && out.moduleName == path) {
+            log << "up to date: " << path << std::endl;
             return true;
         }
-        return false;
-    };
-};
+    }
 
-auto AnyNumber = []() -> TokenMatcher  {
-    return [](Token::type& t) -> bool {
-        if (const auto* typedToken = std::get_if<Token::Number>(&t)) {
-            return true;
-        }
+    log << "assembling: " << path << std::endl;
+    if(!assembleModule(source, path, out, diagnostics))
         return false;
-    };
-};
+    out.sourceHash = sourceHash;
 
-auto Any = []() -> TokenMatcher  {
-    return [](Token::type& t) -> bool {
-        return true;
-    };
-};
-
-int8_t getRegNum(const std::string& input) {
-    if(input == "reg0") return 0;
-    if(input == "reg1") return 1;
-    if(input == "reg2") return 2;
-    if(input == "reg3") return 3;
-    if(input == "reg4") return 4;
-    if(input == "reg5") return 5;
-    if(input == "reg6") return 6;
-    if(input == "reg7") return 7;
-    if(input == "reg8") return 8;
-    if(input == "reg9") return 9;
-    if(input == "reg10") return 10;
-    if(input == "reg11") return 11;
-    if(input == "reg12") return 12;
-    if(input == "reg13") return 13;
-    if(input == "reg14") return 14;
-    if(input == "reg15") return 15;
-    return -1;
+    if(!cachePath.empty()) {
+        std::error_code error;
+        std::filesystem::create_directories(cacheDirectory, error);
+        if(!writeFileAtomic(cachePath, out.serialize()))
+            log << "couldn't write cache: " << cachePath << std::endl;
+    }
+    return true;
 }
 
-auto AnyGenericReg = []() -> TokenMatcher  {
-    return [](Token::type& t) -> bool {
-        if (const auto* typedToken = std::get_if<Token::Label>(&t)) {
-            return getRegNum(typedToken->value) != -1;
-        }
+bool loadObject(const std::string& path, ObjectFile& out, std::vector<Diagnostic>& diagnostics)
+{
+    std::string bytes;
+    if(!readFile(path, bytes)) {
+        diagnostics.push_back({path, 0, "couldn't open file"});
         return false;
-    };
-};
-
-auto CCCCOutput = [](uint16_t param) -> OutputGenerator  {
-    return [param](Context& context, const std::vector<Token::type>&, size_t startIdx)  {
-        context.push(param);
-    };
-};
-
-auto ByteOutput = []() -> OutputGenerator  {
-
-    return [](Context& context, const std::vector<Token::type>& tokens, size_t startIdx) {
-
-        int value {};
-
-        if (const auto* typedToken = std::get_if<Token::Number>(&tokens[startIdx+1])) {
-            value = typedToken->value;
-        }
-        else {
-            exit(-1);
-        }
+    }
+    if(!ObjectFile::deserialize({reinterpret_cast<const uint8_t*>(bytes.data()), bytes.size()}, out)) {
+        diagnostics.push_back({path, 0, "not a chip8Asm object"});
+        return false;
+    }
+    return true;
+}
 
-        context.output.push_back( uint8_t((value >> 0*8)) );
-    };
+struct BuildOptions
+{
+    std::string cacheDirectory {};
+    bool optimizeProgram = false;
+    bool shrinkProgram = false;
+    bool objectsOnly = false;
+    bool hexDump = false;
+    bool sourceMap = true;
+    bool listing = false;
+    bool estimate = false;
+    uint64_t frameBudget {};    // instructions per frame, 0 doesn't check
 };
 
-auto CNNNOutput = [](uint16_t param, int nnnIdx) -> OutputGenerator  {
+// address, bytes and source text of every line that emitted code or data
+void printListing(const AssembleResult& program, std::ostream& log)
+{
+    std::vector<std::vector<std::string>> sources(program.files.size());
+    for(size_t fileIdx = 0; fileIdx != program.files.size(); fileIdx++) {
+        std::string text;
+        if(!readFile(program.files[fileIdx], text))
+            continue; // linked from an object whose source is gone, listed without text
+        std::istringstream lines(text);
+        for(std::string line; std::getline(lines, line);)
+            sources[fileIdx].push_back(line);
+    }
 
-    return [param,nnnIdx](Context& context, const std::vector<Token::type>& tokens, size_t startIdx) {
+    for(size_t locationIdx = 0; locationIdx != program.locations.size(); locationIdx++)
+    {
+        const auto& location = program.locations[locationIdx];
+        const size_t end = locationIdx + 1 != program.locations.size() ? program.locations[locationIdx + 1].address : 0x200 + program.bytes.size();
+
+        std::ostringstream bytes;
+        for(size_t address = location.address; address != end && address != location.address + 6u; address++)
+            bytes << std::hex << std::setw(2) << std::setfill('0') << int(program.bytes[address - 0x200]) << ' ';
+        if(end - location.address > 6)
+            bytes << "...";
+
+        const auto& lines = sources[location.file];
+        const std::string_view text = location.line >= 1 && size_t(location.line) <= lines.size() ? std::string_view(lines[location.line - 1]) : "";
+        char address[8];
+        std::snprintf(address, sizeof(address), "0x%03x", location.address);
+        // lines are prefixed with their module once the program spans several
+        const std::string line = (program.files.size() > 1 ? std::filesystem::path(program.files[location.file]).filename().string() + ":" : "") + std::to_string(location.line);
+        log << address << "  " << std::left << std::setw(21) << bytes.str() << std::setw(6) << line << ' ' << text << std::right << std::endl;
+    }
+}
 
-        int nnn {};
+// per routine instruction counts and worst cases, then per-frame routines over the budget
+void printEstimate(const AssembleResult& program, uint64_t frameBudget, std::ostream& log)
+{
+    std::vector<Diagnostic> warnings;
+    const auto routines = estimateRoutines(program, warnings);
 
-        if (const auto* typedToken = std::get_if<Token::Number>(&tokens[startIdx+nnnIdx])) {
-            nnn = typedToken->value;
-        }
-        else if (const auto* typedToken = std::get_if<Token::Label>(&tokens[startIdx+nnnIdx])) {
-            context.addrRefs[typedToken->value].addressToPut.push_back(context.output.size());
-        }
-        else {
-            exit(-1);
-        }
+    log << std::left << std::setw(28) << "routine" << "address  instructions  worst case" << std::right << std::endl;
+    for(const auto& routine : routines)
+    {
+        char address[8];
+        std::snprintf(address, sizeof(address), "0x%03x", routine.address);
+        log << std::left << std::setw(28) << routine.name << std::setw(9) << address << std::setw(14) << routine.instructions << std::right;
+        if(!routine.called && !routine.perFrame)
+            log << "-";
+        else if(!routine.bounded)
+            log << "unbounded, " << routine.note;
+        else
+            log << routine.worstCase << (routine.perFrame ? " per frame" : "");
+        log << std::endl;
+
+        if(frameBudget == 0 || !routine.perFrame)
+            continue;
+        if(!routine.bounded)
+            warnings.push_back({"", 0, "frame routine " + routine.name + " can't be checked against the budget, its worst case is unbounded"});
+        else if(routine.worstCase > frameBudget)
+            warnings.push_back({"", 0, "frame routine " + routine.name + " takes up to " + std::to_string(routine.worstCase)
+                                       + " instructions, over the budget of " + std::to_string(frameBudget) + " per frame"});
+    }
 
-        uint16_t out = param    | (uint8_t((nnn >> 2 * 4)) & 0b1111) << 2 * 4
-                        | (uint8_t((nnn >> 1 * 4))  & 0b1111) << 1 * 4
-                        | (uint8_t((nnn >> 0 * 4))  & 0b1111) << 0 * 4;
+    for(const auto& warning : warnings)
+        log << "warning: " << warning << std::endl;
+}
 
-        context.push(out);
-    };
+// one program: its root modules, linked in order, and every file the result is written to
+struct BuildJob
+{
+    std::vector<std::string> inputPaths {};
+    std::vector<std::string> outputPaths {};
 };
 
-auto CXKKOutput = [](uint16_t param) -> OutputGenerator  {
-
-    return [param](Context& context, const std::vector<Token::type>& tokens, size_t startIdx) {
-
-        int x {};
-        int kk {};
-
-        if (const auto* typedToken = std::get_if<Token::Label>(&tokens[startIdx+1])) {
-            x = getRegNum(typedToken->value);
-        }
-        if (const auto* typedToken = std::get_if<Token::Number>(&tokens[startIdx+2])) {
-            kk = typedToken->value;
+// builds a single program without touching shared state, so independent jobs can run on any thread;
+// progress goes to log, errors of every module are collected into diagnostics
+bool buildProgram(const BuildJob& job, const BuildOptions& options, std::ostream& log, std::vector<Diagnostic>& diagnostics)
+{
+    // modules in link order: inputs first, then whatever they include, each module once
+    std::vector<ObjectFile> objects;
+    std::vector<std::string> pending(job.inputPaths.begin(), job.inputPaths.end());
+    std::vector<std::string> seen;
+    bool success = true;
+    for(size_t pendingIdx = 0; pendingIdx != pending.size(); pendingIdx++)
+    {
+        const std::string path = pending[pendingIdx];
+        std::error_code error;
+        const auto canonical = std::filesystem::weakly_canonical(path, error).string();
+        if(std::find(seen.begin(), seen.end(), canonical) != seen.end())
+            continue;
+        seen.push_back(canonical);
+
+        ObjectFile object;
+        const bool isObject = std::filesystem::path(path).extension() == ".c8o";
+        if(!(isObject ? loadObject(path, object, diagnostics) : loadModule(path, options.cacheDirectory, object, log, diagnostics))) {
+            success = false; // keep going, so every broken module of the program is reported at once
+            continue;
         }
 
-        int opcode = param | (uint8_t(x) & 0b1111) << 2 * 4
-                     | (uint8_t(kk >> 1 * 4)  & 0b1111) << 1 * 4
-                     | (uint8_t(kk >> 0 * 4)  & 0b1111) << 0 * 4;
-
-        context.push(opcode);
-    };
-};
-auto CXCCOutput = [](uint16_t param, uint16_t xIdx) -> OutputGenerator  {
-
-    return [param,xIdx](Context& context, const std::vector<Token::type>& tokens, size_t startIdx) {
-
-        int x {};
+        if(!isObject)
+            pending.insert(pending.end(), object.includes.begin(), object.includes.end());
+        objects.push_back(std::move(object));
+    }
+    if(!success)
+        return false;
 
-        if (const auto* typedToken = std::get_if<Token::Label>(&tokens[startIdx+xIdx])) {
-            x = getRegNum(typedToken->value);
+    if(options.objectsOnly) {
+        for(const auto& object : objects) {
+            const bool named = objects.size() == 1 && !job.outputPaths.empty();
+            const auto objectPath = named ? job.outputPaths.front() : std::filesystem::path(object.moduleName).replace_extension(".c8o").string();
+            log << "saving object: " << objectPath << std::endl;
+            if(!writeFile(objectPath, object.serialize())) {
+                diagnostics.push_back({objectPath, 0, "couldn't write object"});
+                return false;
+            }
         }
+        return true;
+    }
 
-        int opcode = param | (uint8_t(x) & 0b1111) << 2 * 4;
-
-        context.push(opcode);
-    };
-};
-
-auto CXYCOutput = [](uint16_t param) -> OutputGenerator  {
-
-    return [param](Context& context, const std::vector<Token::type>& tokens, size_t startIdx) {
+    AssembleOptions passes;
+    passes.optimize = options.optimizeProgram;
+    passes.shrink = options.shrinkProgram;
 
-        int x {};
-        int y {};
+    AssembleResult program;
+    if(!linkProgram(objects, passes, program, &log)) {
+        diagnostics.insert(diagnostics.end(), program.diagnostics.begin(), program.diagnostics.end());
+        return false;
+    }
 
-        if (const auto* typedToken = std::get_if<Token::Label>(&tokens[startIdx+1])) {
-            x = getRegNum(typedToken->value);
+    if(options.hexDump)
+        log << hexDump(program.bytes) << std::endl;
+    if(options.listing)
+        printListing(program, log);
+    if(options.estimate)
+        printEstimate(program, options.frameBudget, log);
+
+    // every image is rendered in memory and written with a single call
+    const std::vector<std::string> defaultOutput {"output.ch8"};
+    const auto& outputPaths = job.outputPaths.empty() ? defaultOutput : job.outputPaths;
+    std::string image;
+    for(const auto& outputPath : outputPaths)
+    {
+        if(!renderImage(imageFormatOf(outputPath), program.bytes, image)) {
+            diagnostics.push_back({outputPath, 0, "program of " + std::to_string(program.bytes.size()) + " bytes doesn't fit in memory from 0x200"});
+            success = false;
+            continue;
         }
-        if (const auto* typedToken = std::get_if<Token::Label>(&tokens[startIdx+2])) {
-            y = getRegNum(typedToken->value);
+        log << "saving output: " << outputPath << " (" << program.bytes.size() << " bytes)" << std::endl;
+        if(!writeFile(outputPath, {reinterpret_cast<const uint8_t*>(image.data()), image.size()})) {
+            diagnostics.push_back({outputPath, 0, "couldn't write output"});
+            success = false;
         }
+    }
 
-        int opcode = param | (uint8_t(x) & 0b1111) << 2 * 4 | (uint8_t(y) & 0b1111) << 1 * 4;
-
-        context.push(opcode);
-    };
-};
-
-auto CXYNOutput = [](uint16_t param) -> OutputGenerator  {
-
-    return [param](Context& context, const std::vector<Token::type>& tokens, size_t startIdx) {
-
-        int x {};
-        int y {};
-        int n {};
-
-        if (const auto* typedToken = std::get_if<Token::Label>(&tokens[startIdx+1])) {
-            x = getRegNum(typedToken->value);
-        }
-        if (const auto* typedToken = std::get_if<Token::Label>(&tokens[startIdx+2])) {
-            y = getRegNum(typedToken->value);
+    // addresses back to source lines for the emulator, next to the first output
+    if(options.sourceMap) {
+        const auto mapPath = std::filesystem::path(outputPaths.front()).replace_extension(".c8map").string();
+        if(!writeFile(mapPath, serializeSourceMap(program))) {
+            diagnostics.push_back({mapPath, 0, "couldn't write source map"});
+            success = false;
         }
-        if (const auto* typedToken = std::get_if<Token::Number>(&tokens[startIdx+3])) {
-            n = typedToken->value;
-        }
-
-        int opcode = param | (uint8_t(x) & 0b1111) << 2 * 4 | (uint8_t(y) & 0b1111) << 1 * 4 | (uint8_t(n) & 0b1111) << 0 * 4;
-
-        context.push(opcode);
-    };
-};
+    }
+    return success;
+}
 
-auto RegisterAddress = []() -> OutputGenerator  {
-    return [](Context& context, const std::vector<Token::type>& tokens, size_t startIdx) {
-        if (const auto* typedToken = std::get_if<Token::Label>(&tokens[startIdx+1])) {
-            if( context.addrRefs[typedToken->value].targetLocation != -1 )
-            {
-                std::cout << "redefinition of label: " << typedToken->value << std::endl;
-                exit(-1);
-            }
-            context.addrRefs[typedToken->value].targetLocation = 0x200 + context.output.size();
-            return;
-        }
+// manifest lines are "input [output...]", blank lines and lines starting with # are skipped
+bool readManifest(const std::string& path, std::vector<BuildJob>& jobs)
+{
+    std::string text;
+    if(!readFile(path, text))
+        return false;
 
-        exit(-1);
-    };
-};
+    std::istringstream lines(text);
+    std::string line;
+    while(std::getline(lines, line))
+    {
+        std::istringstream fields(line);
+        BuildJob job;
+        std::string input;
+        if(!(fields >> input) || input.starts_with('#'))
+            continue;
+        job.inputPaths.push_back(input);
+        for(std::string output; fields >> output;)
+            job.outputPaths.push_back(output);
+        jobs.push_back(std::move(job));
+    }
+    return true;
+}
 
-struct OpCode
+// workers pull the next job from a shared index; a job's log is buffered and printed whole, so outputs never interleave
+int runBatch(const std::vector<BuildJob>& jobs, const BuildOptions& options, unsigned threadCount)
 {
-    std::vector<TokenMatcher> tokenSequence;
-    OutputGenerator generator;
-};
+    std::atomic<size_t> nextJob {0};
+    std::atomic<size_t> failed {0};
+    std::mutex printMutex;
 
-std::vector<OpCode> opcodes = {
-    OpCode{{ExactOperator(";"),Any()}, [](auto a, auto b, auto c){} },
-    OpCode{ {ExactOperator(":"), AnyLabel()}, RegisterAddress() },
-    OpCode{{ExactLabel("db"),AnyNumber()}, ByteOutput() },
-
-    OpCode{{ExactLabel("cls")}, CCCCOutput(0x00E0) },
-    OpCode{{ExactLabel("ret")}, CCCCOutput(0x00EE) },
-    OpCode{{ExactLabel("sys"), AnyNumberOrLabel()}, CNNNOutput(0x0000,1) },
-    OpCode{{ExactLabel("call"), AnyNumberOrLabel()}, CNNNOutput(0x2000,1) },
-    OpCode{{ExactLabel("se"), AnyGenericReg(), AnyNumber()}, CXKKOutput(0x3000) },
-    OpCode{{ExactLabel("sne"), AnyGenericReg(), AnyNumber()}, CXKKOutput(0x4000) },
-    OpCode{{ExactLabel("se"), AnyGenericReg(), AnyGenericReg()}, CXYCOutput(0x5000) },
-    OpCode{{ExactLabel("ld"), AnyGenericReg(), AnyNumber()}, CXKKOutput(0x6000) },
-    OpCode{{ExactLabel("add"), AnyGenericReg(), AnyNumber()}, CXKKOutput(0x7000) },
-    OpCode{{ExactLabel("ld"), AnyGenericReg(), AnyGenericReg()}, CXYCOutput(0x8000) },
-    OpCode{{ExactLabel("or"), AnyGenericReg(), AnyGenericReg()}, CXYCOutput(0x8001) },
-    OpCode{{ExactLabel("and"), AnyGenericReg(), AnyGenericReg()}, CXYCOutput(0x8002) },
-    OpCode{{ExactLabel("xor"), AnyGenericReg(), AnyGenericReg()}, CXYCOutput(0x8003) },
-    OpCode{{ExactLabel("add"), AnyGenericReg(), AnyGenericReg()}, CXYCOutput(0x8004) },
-    OpCode{{ExactLabel("sub"), AnyGenericReg(), AnyGenericReg()}, CXYCOutput(0x8005) },
-    OpCode{{ExactLabel("shr"), AnyGenericReg(), AnyGenericReg()}, CXYCOutput(0x8006) },
-    OpCode{{ExactLabel("subn"), AnyGenericReg(), AnyGenericReg()}, CXYCOutput(0x8007) },
-    OpCode{{ExactLabel("shl"), AnyGenericReg(), AnyGenericReg()}, CXYCOutput(0x800E) },
-    OpCode{{ExactLabel("sne"), AnyGenericReg(), AnyGenericReg()}, CXYCOutput(0x9000) },
-
-    OpCode{{ExactLabel("jp"), ExactLabel("reg0"),ExactOperator("+"),AnyNumberOrLabel()}, CNNNOutput(0xB000,3) },
-    OpCode{{ExactLabel("jp"), AnyNumberOrLabel()}, CNNNOutput(0x1000,1) },
-
-    OpCode{{ExactLabel("rnd"), AnyGenericReg(), AnyNumber()}, CXKKOutput(0xC000) },
-    OpCode{{ExactLabel("drw"), AnyGenericReg(),AnyGenericReg(), AnyNumber()}, CXYNOutput(0xD000) },
-
-    OpCode{{ExactLabel("skp"), AnyGenericReg()}, CXCCOutput( 0xE09E,1 ) },
-    OpCode{{ExactLabel("sknp"), AnyGenericReg()}, CXCCOutput( 0xE0A1,1 ) },
-    OpCode{{ExactLabel("ld"), AnyGenericReg(),ExactLabel("delayTimer")}, CXCCOutput( 0xF007,1 ) },
-    OpCode{{ExactLabel("ld"), AnyGenericReg(),ExactLabel("keyPress")}, CXCCOutput( 0xF00A,1) },
-
-    OpCode{{ExactLabel("ld"), ExactLabel("delayTimer"),AnyGenericReg()}, CXCCOutput( 0xF015,2 ) },
-    OpCode{{ExactLabel("ld"), ExactLabel("soundTimer"),AnyGenericReg()}, CXCCOutput( 0xF018,2 ) },
-
-    OpCode{{ExactLabel("add"), ExactLabel("regI"),AnyGenericReg()}, CXCCOutput( 0xF01E, 2 ) },
-    OpCode{{ExactLabel("ld"), ExactLabel("regI"),ExactLabel("spriteOf"),AnyGenericReg()}, CXCCOutput( 0xF029,3) },
-    OpCode{{ExactLabel("ld"), ExactLabel("regI"),AnyNumberOrLabel()}, CNNNOutput(0xA000,2) },
-    OpCode{{ExactLabel("ld"), ExactOperator("*"),ExactLabel("regI"),ExactLabel("bcdOf"),AnyGenericReg()}, CXCCOutput( 0xF033,4 ) },
-    OpCode{{ExactLabel("ld"), ExactOperator("*"),ExactLabel("regI"),ExactLabel("upTo"), AnyGenericReg()}, CXCCOutput( 0xF055,4 ) },
-    OpCode{{ExactLabel("ld"), ExactLabel("upTo"), AnyGenericReg(), ExactOperator("*"),ExactLabel("regI")}, CXCCOutput( 0xF065,2 ) }
-};
+    auto worker = [&]() {
+        for(size_t jobIdx = nextJob++; jobIdx < jobs.size(); jobIdx = nextJob++)
+        {
+            std::ostringstream log;
+            std::vector<Diagnostic> diagnostics;
+            if(!buildProgram(jobs[jobIdx], options, log, diagnostics))
+                failed++;
+
+            std::lock_guard lock(printMutex);
+            std::cout << log.str();
+            for(const auto& diagnostic : diagnostics)
+                std::cout << diagnostic << std::endl;
+        }
+    };
 
+    threadCount = std::max(1u, std::min<unsigned>(threadCount, unsigned(jobs.size())));
+    std::vector<std::thread> workers;
+    for(unsigned threadIdx = 1; threadIdx < threadCount; threadIdx++)
+        workers.emplace_back(worker);
+    worker();
+    for(auto& thread : workers)
+        thread.join();
 
+    std::cout << "batch: " << jobs.size() - failed << " ok, " << failed << " failed" << std::endl;
+    return failed == 0 ? 0 : -1;
+}
 
 int main(int argc, char * argv[]) {
-    std::ifstream file;
-
-    if(argc > 1)
-        file.open(argv[1]);
-    else
-        file.open("./source.c8asm");
-
-    if(!file.good()) {
-        std::cout << "couldn't open file: " << argv[1];
-        return -1;
-    }
-
-    std::stringstream stream{};
-    stream << file.rdbuf();
-    std::string source = stream.str();
-    Context context;
-    TokenIterator it(source);
-    it.addOperator(":");
-    it.addOperator(";");
-    it.addOperator("+");
-    it.addOperator("*");
-
-    std::vector<Token::type> tokens {};
-    int consumedIndex = 0;
-
-    while(!std::holds_alternative<Token::End>(it.next()))
-    {
-        tokens.push_back(it.current());
+    std::vector<std::string> inputPaths;
+    std::vector<std::string> manifestPaths;
+    std::vector<std::string> outputPaths;
+    BuildOptions options;
+    bool batch = false;
+    unsigned threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+    for(int argIdx = 1; argIdx < argc; argIdx++) {
+        const std::string_view arg = argv[argIdx];
+        if(arg == "-O" || arg == "--optimize")
+            options.optimizeProgram = true;
+        else if(arg == "-s" || arg == "--shrink")
+            options.shrinkProgram = true;
+        else if(arg == "-c")
+            options.objectsOnly = true;
+        else if(arg == "-o" && argIdx + 1 < argc)
+            outputPaths.emplace_back(argv[++argIdx]);
+        else if(arg == "--hex")
+            options.hexDump = true;
+        else if(arg == "--no-map")
+            options.sourceMap = false;
+        else if(arg == "--list")
+            options.listing = true;
+        else if(arg == "--estimate")
+            options.estimate = true;
+        else if(arg == "--budget" && argIdx + 1 < argc) {
+            options.estimate = true;
+            options.frameBudget = std::strtoull(argv[++argIdx], nullptr, 10);
+        }
+        else if(arg == "--cache" && argIdx + 1 < argc)
+            options.cacheDirectory = argv[++argIdx];
+        else if(arg == "--batch")
+            batch = true;
+        else if(arg == "--manifest" && argIdx + 1 < argc)
+            manifestPaths.emplace_back(argv[++argIdx]);
+        else if(arg == "-j" && argIdx + 1 < argc)
+            threadCount = unsigned(std::max(1, std::atoi(argv[++argIdx])));
+        else
+            inputPaths.emplace_back(arg);
     }
 
-    while(consumedIndex < tokens.size())
+    // batch: every input (or manifest line) is a program of its own, written next to its source unless named
+    if(batch || !manifestPaths.empty())
     {
-        bool anyMatch = false;
-        for(auto opcode : opcodes)
-        {
-            int matcherIdx = 0;
-            bool success = true;
-            for(auto matcher : opcode.tokenSequence)
-            {
-                if(!matcher(tokens[consumedIndex + matcherIdx])) {
-                    success = false;
-                    break;
-                }
-
-                matcherIdx++;
-            }
-
-            if(!success) {
-                continue;
+        std::vector<BuildJob> jobs;
+        for(const auto& manifestPath : manifestPaths) {
+            if(!readManifest(manifestPath, jobs)) {
+                std::cout << "couldn't open manifest: " << manifestPath << std::endl;
+                return -1;
             }
-
-            opcode.generator(context,tokens,consumedIndex);
-
-
-            consumedIndex += opcode.tokenSequence.size();
-            anyMatch = true;
-            break;
         }
+        for(const auto& inputPath : inputPaths)
+            jobs.push_back({{inputPath}, {}});
 
-        if(!anyMatch) {
-            std::cout << "couldn't consume next opcode, starting at:" << tokens[consumedIndex];
-            exit(-2);
+        for(auto& job : jobs) {
+            if(job.outputPaths.empty() && !options.objectsOnly)
+                job.outputPaths.push_back(std::filesystem::path(job.inputPaths.front()).replace_extension(".ch8").string());
         }
-
-
+        return runBatch(jobs, options, threadCount);
     }
 
-    std::cout << "linking symbols" << std::endl;
-
-    for(auto pairIt : context.addrRefs) {
-        if(pairIt.second.targetLocation == -1) {
-            std::cout << "symbol " << pairIt.first << " was used, but not defined";
-            return -1;
-        }
-        for(auto it : pairIt.second.addressToPut) {
-            context.output[it] = (context.output[it] & 0b11110000) | pairIt.second.targetLocation >> 2 * 4 & 0b1111;
-            context.output[it+1] = pairIt.second.targetLocation;
-        }
-    }
-
-    std::cout << "saving output: ";
-    std::ofstream fs("output.ch8", std::ios::out | std::ios::binary | std::ios::trunc);
-    for(auto it : context.output) {
-        std::cout << std::hex << (int)it << " ";
-        fs << it;
-    }
-    fs.close();
+    if(inputPaths.empty())
+        inputPaths.emplace_back("./source.c8asm");
 
-    return 0;
+    std::vector<Diagnostic> diagnostics;
+    const bool success = buildProgram({inputPaths, outputPaths}, options, std::cout, diagnostics);
+    for(const auto& diagnostic : diagnostics)
+        std::cout << diagnostic << std::endl;
+    return success ? 0 : -1;
 }
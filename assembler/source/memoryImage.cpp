@@ -0,0 +1,142 @@
+#include "memoryImage.hpp"
+#include <algorithm>
+#include <filesystem>
+
+namespace
+{
+    constexpr int memorySize = 4096;
+    constexpr int programStart = 0x200;
+
+    // the font of the fpga cores, as in their initRAM files
+    constexpr uint8_t font[] = {
+        0xF0, 0x90, 0x90, 0x90, 0xF0,
+        0x20, 0x60, 0x20, 0x20, 0x70,
+        0xF0, 0x10, 0xF0, 0x80, 0xF0,
+        0xF0, 0x10, 0xF0, 0x10, 0xF0,
+        0x90, 0x90, 0xF0, 0x10, 0x10,
+        0xF0, 0x80, 0xF0, 0x10, 0xF0,
+        0xF0, 0x80, 0xF0, 0x90, 0xF0,
+        0xF0, 0x10, 0x20, 0x40, 0x40,
+        0xF0, 0x90, 0xF0, 0x90, 0xF0,
+        0xF0, 0x90, 0xF0, 0x10, 0xF0,
+        0xF0, 0x90, 0xF0, 0x90, 0x90,
+        0xE0, 0x90, 0xE0, 0x90, 0xE0,
+        0xF0, 0x80, 0x80, 0x80, 0xF0,
+        0xE0, 0x90, 0x90, 0x90, 0xE0,
+        0xF0, 0x80, 0xF0, 0x80, 0xF0,
+        0xF0, 0x80, 0x80, 0xF0, 0x80
+    };
+
+    constexpr char upperDigits[] = "0123456789ABCDEF";
+    constexpr char lowerDigits[] = "0123456789abcdef";
+
+    void appendHex(std::string& out, unsigned value, const char* digits, int minDigits)
+    {
+        char buffer[8] {};
+        int length = 0;
+        do {
+            buffer[length++] = digits[value & 0xF];
+            value >>= 4;
+        } while(value != 0 || length < minDigits);
+        while(length != 0)
+            out.push_back(buffer[--length]);
+    }
+
+    // one "address : bytes ;" statement, like the hand written files
+    void appendMifRange(std::string& out, int address, std::span<const uint8_t> bytes)
+    {
+        out += "\t";
+        appendHex(out, address, upperDigits, 1);
+        out += " :";
+        for(auto byte : bytes) {
+            out.push_back(' ');
+            appendHex(out, byte, upperDigits, 2);
+        }
+        out += " ;\n";
+    }
+
+    void appendMiRange(std::string& out, int address, std::span<const uint8_t> bytes)
+    {
+        for(auto byte : bytes) {
+            appendHex(out, address++, lowerDigits, 1);
+            out.push_back(':');
+            appendHex(out, byte, upperDigits, 2);
+            out.push_back('\n');
+        }
+    }
+}
+
+ImageFormat imageFormatOf(std::string_view path)
+{
+    const auto extension = std::filesystem::path(path).extension();
+    if(extension == ".mif")
+        return ImageFormat::Mif;
+    if(extension == ".mi")
+        return ImageFormat::Mi;
+    if(extension == ".txt")
+        return ImageFormat::RamInit;
+    return ImageFormat::Ch8;
+}
+
+bool renderImage(ImageFormat format, std::span<const uint8_t> rom, std::string& out)
+{
+    out.clear();
+    if(format == ImageFormat::Ch8) {
+        out.assign(rom.begin(), rom.end());
+        return true;
+    }
+
+    if(rom.size() > size_t(memorySize - programStart))
+        return false;
+
+    switch(format)
+    {
+        case ImageFormat::Mif:
+            out.reserve(160 + 3 * (sizeof(font) + rom.size()));
+            out += "WIDTH=8;\nDEPTH=4096;\n\nADDRESS_RADIX=HEX;\nDATA_RADIX=HEX;\n\nCONTENT BEGIN\n";
+            appendMifRange(out, 0, font);
+            if(!rom.empty())
+                appendMifRange(out, programStart, rom);
+            out += "END;\n";
+            break;
+
+        case ImageFormat::Mi:
+            out.reserve(64 + 8 * (sizeof(font) + rom.size()));
+            out += "#File_format=AddrHex\n#Address_depth=4096\n#Data_width=8\n";
+            appendMiRange(out, 0, font);
+            appendMiRange(out, programStart, rom);
+            break;
+
+        case ImageFormat::RamInit:
+        {
+            // every address is written, so the file replaces the whole 4096 byte image
+            uint8_t memory[memorySize] {};
+            std::copy(std::begin(font), std::end(font), memory);
+            std::copy(rom.begin(), rom.end(), memory + programStart);
+
+            out.resize(memorySize * 9);
+            char* cursor = out.data();
+            for(auto byte : memory) {
+                for(int bit = 7; bit >= 0; bit--)
+                    *cursor++ = (byte >> bit & 1) ? '1' : '0';
+                *cursor++ = '\n';
+            }
+            break;
+        }
+
+        case ImageFormat::Ch8:
+            break;
+    }
+    return true;
+}
+
+std::string hexDump(std::span<const uint8_t> rom)
+{
+    std::string out;
+    out.reserve(rom.size() * 3);
+    for(auto byte : rom) {
+        appendHex(out, byte, lowerDigits, 1);
+        out.push_back(' ');
+    }
+    return out;
+}
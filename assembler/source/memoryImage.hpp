@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+
+// formats the assembled program can be written in, picked from the output file extension
+enum class ImageFormat
+{
+    Ch8,        // raw rom, loaded at 0x200 by the emulator
+    Mif,        // Quartus memory initialization file (fpga_altera)
+    Mi,         // Gowin AddrHex memory initialization file (fpga_tangNano)
+    RamInit,    // one 8 digit binary line per address, read by init_ram_from_file in fpga_tangNano ram.vhd
+};
+
+// .mif, .mi and .txt select the fpga images, anything else is written as a raw rom
+ImageFormat imageFormatOf(std::string_view path);
+
+// memory images hold the font at 0x000 and the program at 0x200 of a 4096 byte address space,
+// returns false when the program doesn't fit there
+bool renderImage(ImageFormat format, std::span<const uint8_t> rom, std::string& out);
+
+// space separated lower case hex of every byte, the assembler's optional dump
+std::string hexDump(std::span<const uint8_t> rom);
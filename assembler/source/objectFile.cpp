@@ -0,0 +1,176 @@
+#include "objectFile.hpp"
+
+namespace
+{
+    class Writer
+    {
+    public:
+        explicit Writer(std::vector<uint8_t>& inOutput) : output(inOutput) {}
+
+        void u8(uint8_t in) { output.push_back(in); }
+        void u16(uint16_t in) { u8(uint8_t(in)); u8(uint8_t(in >> 8)); }
+        void u32(uint32_t in) { u16(uint16_t(in)); u16(uint16_t(in >> 16)); }
+        void u64(uint64_t in) { u32(uint32_t(in)); u32(uint32_t(in >> 32)); }
+        void str(std::string_view in) {
+            u32(uint32_t(in.size()));
+            output.insert(output.end(), in.begin(), in.end());
+        }
+
+    protected:
+        std::vector<uint8_t>& output;
+    };
+
+    // every read checks bounds, a truncated or foreign file just fails to load
+    class Reader
+    {
+    public:
+        explicit Reader(std::span<const uint8_t> inInput) : input(inInput) {}
+
+        bool u8(uint8_t& out) {
+            if(positionIdx + 1 > input.size()) return false;
+            out = input[positionIdx++];
+            return true;
+        }
+        bool u16(uint16_t& out) {
+            uint8_t low {}, high {};
+            if(!u8(low) || !u8(high)) return false;
+            out = uint16_t(low | high << 8);
+            return true;
+        }
+        bool u32(uint32_t& out) {
+            uint16_t low {}, high {};
+            if(!u16(low) || !u16(high)) return false;
+            out = uint32_t(low) | uint32_t(high) << 16;
+            return true;
+        }
+        bool u64(uint64_t& out) {
+            uint32_t low {}, high {};
+            if(!u32(low) || !u32(high)) return false;
+            out = uint64_t(low) | uint64_t(high) << 32;
+            return true;
+        }
+        bool str(std::string& out) {
+            uint32_t length {};
+            if(!u32(length) || positionIdx + length > input.size()) return false;
+            out.assign(reinterpret_cast<const char*>(input.data()) + positionIdx, length);
+            positionIdx += length;
+            return true;
+        }
+        bool strings(std::vector<std::string>& out) {
+            uint32_t count {};
+            if(!u32(count) || count > input.size() - positionIdx) return false;
+            out.resize(count);
+            for(auto& it : out)
+                if(!str(it)) return false;
+            return true;
+        }
+
+    protected:
+        std::span<const uint8_t> input;
+        size_t positionIdx {};
+    };
+
+    constexpr uint8_t magic[4] = {'C','8','O','B'};
+}
+
+std::vector<uint8_t> ObjectFile::serialize() const
+{
+    std::vector<uint8_t> result;
+    result.reserve(64 + program.size() * 11);
+    Writer out(result);
+
+    for(auto it : magic)
+        out.u8(it);
+    out.u32(version);
+    out.u64(sourceHash);
+    out.str(moduleName);
+
+    out.u32(uint32_t(includes.size()));
+    for(const auto& it : includes)
+        out.str(it);
+
+    out.u32(uint32_t(symbols.size()));
+    for(const auto& it : symbols)
+        out.str(it);
+
+    out.u32(uint32_t(program.size()));
+    for(const auto& it : program) {
+        out.u8(uint8_t(it.kind));
+        out.u16(it.value);
+        out.u32(it.symbol);
+        out.u32(uint32_t(it.line));
+    }
+
+    out.u32(uint32_t(annotations.size()));
+    for(const auto& it : annotations) {
+        out.u32(uint32_t(it.line));
+        out.str(it.text);
+    }
+    return result;
+}
+
+bool ObjectFile::deserialize(std::span<const uint8_t> in, ObjectFile& out)
+{
+    Reader reader(in);
+
+    for(auto it : magic) {
+        uint8_t read {};
+        if(!reader.u8(read) || read != it)
+            return false;
+    }
+
+    uint32_t readVersion {};
+    if(!reader.u32(readVersion) || readVersion != version)
+        return false;
+
+    if(!reader.u64(out.sourceHash) || !reader.str(out.moduleName) || !reader.strings(out.includes) || !reader.strings(out.symbols))
+        return false;
+
+    uint32_t count {};
+    if(!reader.u32(count) || count > in.size())
+        return false;
+
+    out.program.resize(count);
+    for(auto& it : out.program)
+    {
+        uint8_t kind {};
+        uint32_t line {};
+        if(!reader.u8(kind) || !reader.u16(it.value) || !reader.u32(it.symbol) || !reader.u32(line))
+            return false;
+        if(kind > uint8_t(Emitted::Kind::Label))
+            return false;
+
+        const bool needsSymbol = kind == uint8_t(Emitted::Kind::Label);
+        if(it.symbol != SymbolInterner::invalidId ? it.symbol >= out.symbols.size() : needsSymbol)
+            return false;
+
+        it.kind = Emitted::Kind(kind);
+        it.line = int(line);
+    }
+
+    if(!reader.u32(count) || count > in.size())
+        return false;
+
+    out.annotations.resize(count);
+    for(auto& it : out.annotations)
+    {
+        uint32_t line {};
+        if(!reader.u32(line) || !reader.str(it.text))
+            return false;
+        it.line = int(line);
+    }
+    return true;
+}
+
+uint64_t hashSource(std::string_view source, std::string_view moduleName)
+{
+    uint64_t result = 14695981039346656037ull; // FNV-1a, seeded with the format version
+    result = (result ^ ObjectFile::version) * 1099511628211ull;
+    for(auto text : {moduleName, std::string_view("\0",1), source}) {
+        for(auto charIt : text) {
+            result ^= uint8_t(charIt);
+            result *= 1099511628211ull;
+        }
+    }
+    return result;
+}
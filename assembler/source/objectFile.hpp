@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "context.hpp"
+
+// relocatable result of assembling one module, before linking
+//
+// the program keeps code, data and label definitions symbolic, every symbol field is an index
+// into symbols (the module symbol table), instructions carrying one are the fixups
+//
+// layout (little endian):  "C8OB" u32 version, u64 sourceHash, str moduleName,
+//                          u32 count + str includes, u32 count + str symbols,
+//                          u32 count + items { u8 kind, u16 value, u32 symbol, u32 line },
+//                          u32 count + annotations { u32 line, str text }
+//                          where str is u32 length + bytes
+struct ObjectFile
+{
+    static constexpr uint32_t version = 2;
+
+    std::string moduleName {};
+    uint64_t sourceHash {};
+    std::vector<std::string> includes {};
+    std::vector<std::string> symbols {};
+    std::vector<Emitted> program {};
+    std::vector<Annotation> annotations {};     // only line and text are kept
+
+    std::vector<uint8_t> serialize() const;
+    static bool deserialize(std::span<const uint8_t> in, ObjectFile& out);
+};
+
+// content hash of a module source and its path (includes resolve relative to it), keys the object cache
+uint64_t hashSource(std::string_view source, std::string_view moduleName);
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "context.hpp"
+
+// classification of emitted opcodes shared by the passes working on Context::program
+namespace OpcodeInfo
+{
+    inline bool isSkip(uint16_t opcode)
+    {
+        switch(opcode & 0xF000) {
+            case 0x3000: case 0x4000: case 0x5000: case 0x9000: return true;
+            case 0xE000: return (opcode & 0x00FF) == 0x9E || (opcode & 0x00FF) == 0xA1;
+            default: return false;
+        }
+    }
+
+    inline bool isUnconditionalTransfer(uint16_t opcode)
+    {
+        return opcode == 0x00EE || (opcode & 0xF000) == 0x1000 || (opcode & 0xF000) == 0xB000;
+    }
+
+    // opcodes whose nnn is an address
+    inline bool usesAddress(uint16_t opcode)
+    {
+        switch(opcode & 0xF000) {
+            case 0x1000: case 0x2000: case 0xA000: case 0xB000: return true;
+            case 0x0000: return opcode != 0x00E0 && opcode != 0x00EE;
+            default: return false;
+        }
+    }
+
+    // a numeric nnn pointing into the program pins its layout, passes moving code must then leave it alone
+    inline bool usesNumericProgramAddress(const std::vector<Emitted>& program)
+    {
+        for(const auto& item : program)
+            if(item.isInstruction() && usesAddress(item.value) && item.symbol == SymbolInterner::invalidId && (item.value & 0x0FFF) >= 0x200)
+                return true;
+        return false;
+    }
+}
@@ -0,0 +1,347 @@
+#include "optimizer.hpp"
+#include "opcodeInfo.hpp"
+#include <algorithm>
+#include <array>
+
+namespace
+{
+    struct RegEffects {
+        uint16_t reads {};
+        uint16_t writes {};
+        bool barrier {}; // leaves the block, or reads registers we can't see
+    };
+
+    uint8_t regX(uint16_t opcode) { return (opcode & 0x0F00) >> 2*4; }
+    uint8_t regY(uint16_t opcode) { return (opcode & 0x00F0) >> 1*4; }
+    uint16_t bit(uint8_t reg) { return uint16_t(1) << reg; }
+    uint16_t upTo(uint8_t reg) { return uint16_t((uint32_t(1) << (reg + 1)) - 1); }
+
+    constexpr uint16_t VF = uint16_t(1) << 15;
+
+    RegEffects effects(uint16_t opcode)
+    {
+        const uint8_t x = regX(opcode);
+        const uint8_t y = regY(opcode);
+
+        switch(opcode & 0xF000) {
+            case 0x0000:
+                if(opcode == 0x00E0) return {};
+                if(opcode == 0x00EE) return {0, 0, true};
+                return {0xFFFF}; // sys dumps all registers
+            case 0x1000: case 0x2000: return {0, 0, true};
+            case 0xB000: return {bit(0), 0, true};
+            case 0x3000: case 0x4000: return {bit(x)};
+            case 0x5000: case 0x9000: return {uint16_t(bit(x) | bit(y))};
+            case 0x6000: return {0, bit(x)};
+            case 0x7000: return {bit(x), bit(x)};
+            case 0x8000:
+                switch(opcode & 0x000F) {
+                    case 0x0: return {bit(y), bit(x)};
+                    case 0x6: case 0xE: return {bit(y), uint16_t(bit(x) | VF)};
+                    default: return {uint16_t(bit(x) | bit(y)), uint16_t(bit(x) | VF)};
+                }
+            case 0xA000: return {};
+            case 0xC000: return {0, bit(x)};
+            case 0xD000: return {uint16_t(bit(x) | bit(y)), VF};
+            case 0xE000: return {bit(x)};
+            case 0xF000:
+                switch(opcode & 0x00FF) {
+                    case 0x07: case 0x0A: return {0, bit(x)};
+                    case 0x55: return {upTo(x)};
+                    case 0x65: return {0, upTo(x)};
+                    default: return {bit(x)};
+                }
+        }
+        return {0xFFFF, 0xFFFF, true};
+    }
+
+    class Passes
+    {
+    public:
+        Passes(std::vector<Emitted>& inProgram, OptimizerReport& inReport) : program(inProgram), report(inReport) {}
+
+        bool run()
+        {
+            analyze();
+            removed.assign(program.size(), false);
+
+            threadJumps();
+            for(size_t idx = 0; idx != program.size(); idx++)
+            {
+                if(removed[idx] || !program[idx].isInstruction() || pinned[idx] || conditional[idx])
+                    continue;
+
+                tailCall(idx) || mergeAdds(idx) || deadStore(idx) || dropUnreachable(idx);
+            }
+
+            return compact() || threaded;
+        }
+
+    protected:
+        void analyze()
+        {
+            uint32_t symbolCount {};
+            for(const auto& item : program)
+                if(item.symbol != SymbolInterner::invalidId)
+                    symbolCount = std::max(symbolCount, item.symbol + 1);
+
+            referenced.assign(symbolCount, false);
+            addressTaken.assign(symbolCount, false);
+            labelIdx.assign(symbolCount, program.size());
+
+            for(size_t idx = 0; idx != program.size(); idx++)
+            {
+                const auto& item = program[idx];
+                if(item.isLabel())
+                    labelIdx[item.symbol] = idx;
+                else if(item.isInstruction() && item.symbol != SymbolInterner::invalidId) {
+                    referenced[item.symbol] = true;
+                    const auto group = item.value & 0xF000;
+                    if(group != 0x1000 && group != 0x2000)
+                        addressTaken[item.symbol] = true;
+                }
+            }
+
+            pinned.assign(program.size(), false);
+            conditional.assign(program.size(), false);
+            bool inPinnedBlock = false;
+            bool afterSkip = false;
+            for(size_t idx = 0; idx != program.size(); idx++)
+            {
+                const auto& item = program[idx];
+                if(item.isLabel()) {
+                    if(referenced[item.symbol])
+                        inPinnedBlock = addressTaken[item.symbol];
+                    continue;
+                }
+                pinned[idx] = inPinnedBlock;
+                conditional[idx] = afterSkip;
+                afterSkip = item.isInstruction() && OpcodeInfo::isSkip(item.value);
+            }
+        }
+
+        // first instruction index executed when jumping to the label, or program.size()
+        size_t targetOf(uint32_t symbol) const
+        {
+            size_t idx = labelIdx[symbol];
+            while(idx < program.size() && program[idx].isLabel())
+                idx++;
+            return idx < program.size() && program[idx].isInstruction() ? idx : program.size();
+        }
+
+        // retargets a jump to the end of the chain of jumps it lands on; a chain running into a cycle ends where it
+        // enters the cycle, and a jump that is part of a cycle stays as it is, going around it makes nothing shorter
+        void threadJumps()
+        {
+            constexpr size_t maxHops = 16;
+            threaded = false;
+            for(size_t idx = 0; idx != program.size(); idx++)
+            {
+                auto& item = program[idx];
+                if(!item.isInstruction() || (item.value & 0xF000) != 0x1000 || item.symbol == SymbolInterner::invalidId || pinned[idx])
+                    continue;
+
+                std::array<uint32_t,maxHops + 1> symbols {item.symbol}; // symbols[hops] is where the jump would go
+                std::array<size_t,maxHops + 1> targets {};              // first instruction of each of them
+                size_t hops = 0;
+                for(;;)
+                {
+                    const size_t targetIdx = targetOf(symbols[hops]);
+                    if(targetIdx == program.size() || pinned[targetIdx])
+                        break;
+                    if(targetIdx == idx) {
+                        hops = 0;
+                        break;
+                    }
+                    const auto repeat = std::find(targets.begin(), targets.begin() + hops, targetIdx);
+                    if(repeat != targets.begin() + hops) {
+                        hops = size_t(repeat - targets.begin());
+                        break;
+                    }
+                    targets[hops] = targetIdx;
+
+                    const auto& target = program[targetIdx];
+                    if((target.value & 0xF000) != 0x1000 || target.symbol == SymbolInterner::invalidId || hops == maxHops)
+                        break;
+                    symbols[++hops] = target.symbol;
+                }
+
+                if(hops != 0) {
+                    item.symbol = symbols[hops];
+                    report.threadedJumps += hops;
+                    threaded = true;
+                }
+            }
+        }
+
+        // index of the next item if it is an instruction directly following idx, with no label in between
+        size_t adjacentInstruction(size_t idx) const
+        {
+            const size_t nextIdx = idx + 1;
+            if(nextIdx < program.size() && !removed[nextIdx] && program[nextIdx].isInstruction() && !pinned[nextIdx])
+                return nextIdx;
+            return program.size();
+        }
+
+        bool tailCall(size_t idx)
+        {
+            auto& item = program[idx];
+            if((item.value & 0xF000) != 0x2000)
+                return false;
+
+            const size_t nextIdx = adjacentInstruction(idx);
+            if(nextIdx == program.size() || program[nextIdx].value != 0x00EE)
+                return false;
+
+            item.value = 0x1000 | (item.value & 0x0FFF);
+            removed[nextIdx] = true;
+            report.tailCalls++;
+            return true;
+        }
+
+        bool mergeAdds(size_t idx)
+        {
+            auto& item = program[idx];
+            if((item.value & 0xF000) != 0x7000)
+                return false;
+
+            const size_t nextIdx = adjacentInstruction(idx);
+            if(nextIdx == program.size() || (program[nextIdx].value & 0xFF00) != (item.value & 0xFF00))
+                return false;
+
+            const uint8_t sum = uint8_t(item.value + program[nextIdx].value);
+            item.value = (item.value & 0xFF00) | sum;
+            removed[nextIdx] = true;
+            report.mergedAdds++;
+
+            if(sum == 0) { // add of 0 doesn't touch VF either
+                removed[idx] = true;
+                report.mergedAdds++;
+            }
+            return true;
+        }
+
+        bool deadStore(size_t idx)
+        {
+            const auto& item = program[idx];
+            const bool isLoad = (item.value & 0xF000) == 0x6000 || (item.value & 0xF00F) == 0x8000;
+            if(!isLoad)
+                return false;
+
+            const uint8_t x = regX(item.value);
+            bool dead = (item.value & 0xF00F) == 0x8000 && regY(item.value) == x; // ld Vx Vx
+
+            for(size_t nextIdx = idx + 1; !dead && nextIdx < program.size(); nextIdx++)
+            {
+                if(removed[nextIdx])
+                    continue;
+
+                const auto& next = program[nextIdx];
+                if(!next.isInstruction())
+                    break;
+
+                const auto nextEffects = effects(next.value);
+                if(nextEffects.barrier || (nextEffects.reads & bit(x)))
+                    break;
+                if((nextEffects.writes & bit(x)) && !conditional[nextIdx])
+                    dead = true;
+            }
+
+            if(!dead)
+                return false;
+
+            removed[idx] = true;
+            report.deadStores++;
+            return true;
+        }
+
+        bool dropUnreachable(size_t idx)
+        {
+            if(!OpcodeInfo::isUnconditionalTransfer(program[idx].value))
+                return false;
+
+            bool any = false;
+            for(size_t nextIdx = idx + 1; nextIdx < program.size(); nextIdx++)
+            {
+                const auto& next = program[nextIdx];
+                if(next.isLabel() && referenced[next.symbol])
+                    break;
+                if(next.kind == Emitted::Kind::Byte)
+                    break;
+                if(next.isInstruction() && !removed[nextIdx]) {
+                    removed[nextIdx] = true;
+                    report.unreachable++;
+                    any = true;
+                }
+            }
+            return any;
+        }
+
+        bool compact()
+        {
+            size_t writeIdx = 0;
+            for(size_t readIdx = 0; readIdx != program.size(); readIdx++)
+                if(!removed[readIdx])
+                    program[writeIdx++] = program[readIdx];
+
+            const bool changed = writeIdx != program.size();
+            program.resize(writeIdx);
+            return changed;
+        }
+
+    protected:
+        std::vector<Emitted>& program;
+        OptimizerReport& report;
+
+        std::vector<bool> referenced {};
+        std::vector<bool> addressTaken {};
+        std::vector<size_t> labelIdx {};
+        std::vector<bool> pinned {};
+        std::vector<bool> conditional {};
+        std::vector<bool> removed {};
+        bool threaded {};
+    };
+
+    size_t countInstructions(const std::vector<Emitted>& program)
+    {
+        size_t result {};
+        for(const auto& item : program)
+            result += item.isInstruction();
+        return result;
+    }
+}
+
+std::ostream& operator<<(std::ostream& os, const OptimizerReport& in)
+{
+    if(in.skipped) {
+        os << "optimizer: skipped, program jumps to or loads numeric addresses inside itself";
+        return os;
+    }
+
+    os << "optimizer: " << in.instructionsBefore << " -> " << in.instructionsAfter << " instructions"
+       << " (saved " << in.instructionsBefore - in.instructionsAfter << ")"
+       << ", threaded jumps: " << in.threadedJumps
+       << ", dead stores: " << in.deadStores
+       << ", merged adds: " << in.mergedAdds
+       << ", tail calls: " << in.tailCalls
+       << ", unreachable: " << in.unreachable;
+    return os;
+}
+
+OptimizerReport optimize(std::vector<Emitted>& program)
+{
+    OptimizerReport report {};
+    report.instructionsBefore = countInstructions(program);
+    report.instructionsAfter = report.instructionsBefore;
+
+    if(OpcodeInfo::usesNumericProgramAddress(program)) {
+        report.skipped = true;
+        return report;
+    }
+
+    Passes passes(program, report);
+    for(int iteration = 0; iteration != 64 && passes.run(); iteration++) {}
+
+    report.instructionsAfter = countInstructions(program);
+    return report;
+}
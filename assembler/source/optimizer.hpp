@@ -0,0 +1,31 @@
+#pragma once
+
+#include <ostream>
+#include "context.hpp"
+
+struct OptimizerReport
+{
+    size_t instructionsBefore {};
+    size_t instructionsAfter {};
+
+    size_t threadedJumps {};
+    size_t deadStores {};
+    size_t mergedAdds {};
+    size_t tailCalls {};
+    size_t unreachable {};
+
+    bool skipped {}; // program uses numeric code addresses, its layout can't change
+};
+
+std::ostream& operator<<(std::ostream& os, const OptimizerReport& in);
+
+// peephole passes over the emitted program before linking, repeated until nothing changes:
+// - jump threading: jp to a jp goes straight to the final target
+// - dead stores: ld Vx overwritten before any read within the same block
+// - consecutive add Vx kk on the same register are merged
+// - call X followed by ret becomes jp X
+// - instructions after an unconditional jp/ret that no label reaches are dropped
+//
+// instructions behind skips are never touched (the skip would shift), neither are blocks whose
+// label is used as data or computed jump target (ld regI / jp reg0 + / sys), as they may be self-modified
+OptimizerReport optimize(std::vector<Emitted>& program);
@@ -0,0 +1,353 @@
+#include "reducer.hpp"
+#include "opcodeInfo.hpp"
+#include <algorithm>
+#include <deque>
+
+namespace
+{
+    struct Block {
+        size_t beginIdx {};
+        size_t endIdx {};
+
+        bool live {};
+        bool named {};                  // one of its labels is referenced
+        bool hasContent {};
+        bool hasCode {};
+        bool fallsThrough {true};
+        bool written {};
+
+        std::vector<uint8_t> bytes {};
+
+        size_t mergedInto {SIZE_MAX};   // host block when the bytes were found elsewhere
+        size_t mergedOffset {};         // byte offset of the labels inside the host
+        size_t overlap {};              // leading bytes shared with the tail of the previous block
+        bool hostsMerged {};
+        bool continued {};              // followed by unnamed data, so it can't be moved away from it
+        bool continuation {};           // that unnamed data, reached by indexing past the block before it
+    };
+
+    size_t programSize(const std::vector<Emitted>& program)
+    {
+        size_t result {};
+        for(const auto& item : program)
+            result += item.size();
+        return result;
+    }
+
+    class Reducer
+    {
+    public:
+        Reducer(std::vector<Emitted>& inProgram, ReducerReport& inReport) : program(inProgram), report(inReport) {}
+
+        void run()
+        {
+            split();
+            markLive();
+            bool canMerge = markWritten();
+            if(canMerge) {
+                mergeContained();
+                mergeOverlapping();
+            }
+            rebuild();
+        }
+
+    protected:
+        void split()
+        {
+            uint32_t symbolCount {};
+            for(const auto& item : program)
+                if(item.symbol != SymbolInterner::invalidId)
+                    symbolCount = std::max(symbolCount, item.symbol + 1);
+
+            std::vector<bool> referenced(symbolCount);
+            for(const auto& item : program)
+                if(item.isInstruction() && item.symbol != SymbolInterner::invalidId)
+                    referenced[item.symbol] = true;
+
+            blockOfSymbol.assign(symbolCount, SIZE_MAX);
+            blocks.push_back({});
+            bool afterSkip = false;
+            for(size_t idx = 0; idx != program.size(); idx++)
+            {
+                const auto& item = program[idx];
+                // a block holding only labels so far is extended instead, so adjacent labels share one block
+                if(item.isLabel() && blocks.back().hasContent) {
+                    blocks.back().endIdx = idx;
+                    blocks.push_back({idx});
+                }
+
+                auto& block = blocks.back();
+                if(item.isLabel()) {
+                    blockOfSymbol[item.symbol] = blocks.size() - 1;
+                    block.named = block.named || referenced[item.symbol];
+                    continue;
+                }
+
+                block.hasContent = true;
+                if(item.isInstruction()) {
+                    block.hasCode = true;
+                    block.fallsThrough = !OpcodeInfo::isUnconditionalTransfer(item.value) || afterSkip;
+                    afterSkip = OpcodeInfo::isSkip(item.value);
+                }
+                else {
+                    block.bytes.push_back(uint8_t(item.value));
+                    block.fallsThrough = false;
+                    afterSkip = false;
+                }
+            }
+            blocks.back().endIdx = program.size();
+        }
+
+        void markLive()
+        {
+            std::deque<size_t> pending {0};
+            blocks[0].live = true;
+
+            auto visit = [&](size_t blockIdx) {
+                if(blockIdx < blocks.size() && !blocks[blockIdx].live) {
+                    blocks[blockIdx].live = true;
+                    pending.push_back(blockIdx);
+                }
+            };
+
+            while(!pending.empty())
+            {
+                const size_t blockIdx = pending.front();
+                pending.pop_front();
+                const auto& block = blocks[blockIdx];
+
+                for(size_t idx = block.beginIdx; idx != block.endIdx; idx++)
+                {
+                    const auto& item = program[idx];
+                    if(item.isInstruction() && item.symbol != SymbolInterner::invalidId && item.symbol < blockOfSymbol.size())
+                        visit(blockOfSymbol[item.symbol]);
+                }
+                if(block.fallsThrough)
+                    visit(blockIdx + 1);
+                else if(!block.bytes.empty() && blockIdx + 1 < blocks.size() && !blocks[blockIdx + 1].named) {
+                    blocks[blockIdx].continued = true;
+                    blocks[blockIdx + 1].continuation = true;
+                    visit(blockIdx + 1); // data under a label nothing names is only reachable by indexing past this block
+                }
+            }
+
+            for(const auto& block : blocks) {
+                if(block.live) continue;
+                if(block.hasCode) report.removedRoutines++;
+                else if(!block.bytes.empty()) report.removedData++;
+            }
+        }
+
+        // follows regI through each live block, false when something is written through an unknown regI
+        bool markWritten()
+        {
+            for(const auto& block : blocks)
+            {
+                if(!block.live || !block.hasCode)
+                    continue;
+
+                size_t target = SIZE_MAX; // block regI points into
+                bool known = false;       // regI is unknown at block entry
+                for(size_t idx = block.beginIdx; idx != block.endIdx; idx++)
+                {
+                    const auto& item = program[idx];
+                    if(!item.isInstruction())
+                        continue;
+
+                    const uint16_t opcode = item.value;
+                    if((opcode & 0xF000) == 0xA000) {
+                        known = true;
+                        target = item.symbol != SymbolInterner::invalidId ? blockOfSymbol[item.symbol] : SIZE_MAX;
+                    }
+                    else if((opcode & 0xF0FF) == 0xF029) {
+                        known = true;
+                        target = SIZE_MAX; // font
+                    }
+                    else if((opcode & 0xF0FF) == 0xF033 || (opcode & 0xF0FF) == 0xF055) {
+                        if(!known)
+                            return false;
+                        if(target != SIZE_MAX)
+                            blocks[target].written = true;
+                    }
+                }
+            }
+
+            // writes through a block can index on into the data chained behind it
+            for(size_t blockIdx = 0; blockIdx + 1 < blocks.size(); blockIdx++)
+                if(blocks[blockIdx].written && blocks[blockIdx].continued)
+                    blocks[blockIdx + 1].written = true;
+            return true;
+        }
+
+        // a chain of continued blocks and their continuations is read as one unit, its layout has to stay as it is
+        bool isMergeCandidate(const Block& block) const
+        {
+            return block.live && !block.hasCode && !block.written && !block.bytes.empty() && block.mergedInto == SIZE_MAX
+                && !block.continued && !block.continuation;
+        }
+
+        void mergeContained()
+        {
+            std::vector<size_t> order;
+            for(size_t blockIdx = 0; blockIdx != blocks.size(); blockIdx++)
+                if(isMergeCandidate(blocks[blockIdx]))
+                    order.push_back(blockIdx);
+
+            std::stable_sort(order.begin(), order.end(), [this](size_t lhs, size_t rhs) {
+                return blocks[lhs].bytes.size() > blocks[rhs].bytes.size();
+            });
+
+            for(size_t orderIdx = 0; orderIdx != order.size(); orderIdx++)
+            {
+                auto& block = blocks[order[orderIdx]];
+                for(size_t hostOrderIdx = 0; hostOrderIdx != orderIdx; hostOrderIdx++)
+                {
+                    const size_t hostIdx = order[hostOrderIdx];
+                    const auto& host = blocks[hostIdx];
+                    if(host.mergedInto != SIZE_MAX)
+                        continue;
+
+                    auto found = std::search(host.bytes.begin(), host.bytes.end(), block.bytes.begin(), block.bytes.end());
+                    if(found == host.bytes.end())
+                        continue;
+
+                    block.mergedInto = hostIdx;
+                    block.mergedOffset = found - host.bytes.begin();
+                    blocks[hostIdx].hostsMerged = true;
+                    report.mergedData++;
+                    break;
+                }
+            }
+        }
+
+        void mergeOverlapping()
+        {
+            size_t previousIdx = SIZE_MAX;
+            for(size_t blockIdx = 0; blockIdx != blocks.size(); blockIdx++)
+            {
+                auto& block = blocks[blockIdx];
+                if(!block.live || block.mergedInto != SIZE_MAX)
+                    continue;
+
+                if(previousIdx != SIZE_MAX && isMergeCandidate(block) && !block.hostsMerged && isMergeCandidate(blocks[previousIdx])) {
+                    const auto& previous = blocks[previousIdx];
+                    const size_t previousTail = previous.bytes.size() - blocks[previousIdx].overlap;
+                    for(size_t length = std::min(previousTail, block.bytes.size() - 1); length != 0; length--)
+                    {
+                        if(std::equal(block.bytes.begin(), block.bytes.begin() + length, previous.bytes.end() - length)) {
+                            block.overlap = length;
+                            report.mergedData++;
+                            break;
+                        }
+                    }
+                }
+                previousIdx = blockIdx;
+            }
+        }
+
+        void rebuild()
+        {
+            // labels of merged blocks, moved in front of the host byte they now point at
+            std::vector<std::vector<std::pair<size_t,size_t>>> aliases(blocks.size()); // (offset, block)
+            for(size_t blockIdx = 0; blockIdx != blocks.size(); blockIdx++)
+                if(blocks[blockIdx].live && blocks[blockIdx].mergedInto != SIZE_MAX)
+                    aliases[blocks[blockIdx].mergedInto].push_back({blocks[blockIdx].mergedOffset, blockIdx});
+
+            std::vector<Emitted> result;
+            result.reserve(program.size());
+
+            auto copyLabels = [&](const Block& block) {
+                for(size_t idx = block.beginIdx; idx != block.endIdx; idx++)
+                    if(program[idx].isLabel())
+                        result.push_back(program[idx]);
+            };
+
+            for(size_t blockIdx = 0; blockIdx != blocks.size(); blockIdx++)
+            {
+                const auto& block = blocks[blockIdx];
+                if(!block.live || block.mergedInto != SIZE_MAX)
+                    continue;
+
+                if(block.overlap != 0) {
+                    // step back into the tail of the previous block that holds the shared bytes
+                    size_t insertIdx = result.size();
+                    for(size_t bytes = 0; bytes != block.overlap; insertIdx--)
+                        bytes += result[insertIdx - 1].kind == Emitted::Kind::Byte;
+
+                    std::vector<Emitted> labels;
+                    for(size_t idx = block.beginIdx; idx != block.endIdx; idx++)
+                        if(program[idx].isLabel())
+                            labels.push_back(program[idx]);
+                    result.insert(result.begin() + insertIdx, labels.begin(), labels.end());
+                }
+
+                size_t byteOffset = 0;
+                size_t skipBytes = block.overlap;
+                for(size_t idx = block.beginIdx; idx != block.endIdx; idx++)
+                {
+                    const auto& item = program[idx];
+                    if(item.isLabel() && block.overlap != 0)
+                        continue;
+
+                    if(item.kind == Emitted::Kind::Byte) {
+                        for(const auto& [offset, aliasIdx] : aliases[blockIdx])
+                            if(offset == byteOffset)
+                                copyLabels(blocks[aliasIdx]);
+                        byteOffset++;
+
+                        if(skipBytes != 0) {
+                            skipBytes--;
+                            continue;
+                        }
+                    }
+                    result.push_back(item);
+                }
+            }
+
+            program = std::move(result);
+        }
+
+    protected:
+        std::vector<Emitted>& program;
+        ReducerReport& report;
+
+        std::vector<Block> blocks {};
+        std::vector<size_t> blockOfSymbol {};
+    };
+}
+
+std::ostream& operator<<(std::ostream& os, const ReducerReport& in)
+{
+    if(in.skipped) {
+        os << "reducer: skipped, program jumps to or loads numeric addresses inside itself";
+        return os;
+    }
+
+    os << "reducer: " << in.bytesBefore << " -> " << in.bytesAfter << " bytes"
+       << " (saved " << in.bytesBefore - in.bytesAfter << ")"
+       << ", removed routines: " << in.removedRoutines
+       << ", removed data blocks: " << in.removedData
+       << ", merged data blocks: " << in.mergedData;
+    return os;
+}
+
+ReducerReport reduce(std::vector<Emitted>& program)
+{
+    ReducerReport report {};
+    report.bytesBefore = programSize(program);
+    report.bytesAfter = report.bytesBefore;
+
+    if(program.empty())
+        return report;
+
+    if(OpcodeInfo::usesNumericProgramAddress(program)) {
+        report.skipped = true;
+        return report;
+    }
+
+    Reducer reducer(program, report);
+    reducer.run();
+
+    report.bytesAfter = programSize(program);
+    return report;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <ostream>
+#include "context.hpp"
+
+struct ReducerReport
+{
+    size_t bytesBefore {};
+    size_t bytesAfter {};
+
+    size_t removedRoutines {};
+    size_t removedData {};
+    size_t mergedData {};
+
+    bool skipped {}; // program uses numeric code addresses, its layout can't change
+};
+
+std::ostream& operator<<(std::ostream& os, const ReducerReport& in);
+
+// whole program size reduction before linking
+//
+// the program is cut into blocks at labels, blocks reachable from 0x200 through fallthrough and
+// jp/call/ld regI/jp reg0 +/sys references are kept, the rest is dropped; data under a label nothing
+// names is kept together with the live data block before it, as it can only be reached by indexing
+// past that one (like v_pipe_1 behind v_pipe_0)
+//
+// data-only blocks that are never written through Fx33/Fx55 (a write through a block counts for
+// the unnamed data chained behind it too), and that are not part of such a chain, are then merged: a block found inside
+// another one becomes a label into it, and a block directly following another one reuses
+// the longest overlap of that one's tail; blocks are assumed not to be read past their end
+ReducerReport reduce(std::vector<Emitted>& program);
@@ -0,0 +1,52 @@
+#include "chip8asm.hpp"
+
+// .c8map layout, little endian, read by emulator/sources/sourceMap.c:
+//   "C8SM" u16 version
+//   u16 file count,     per file:     u16 length, name bytes
+//   u16 label count,    per label:    u16 address, u16 length, name bytes (ordered by address)
+//   u32 location count, per location: u16 address, u16 file, u32 line (ordered by address)
+
+namespace
+{
+    constexpr uint16_t sourceMapVersion = 1;
+
+    void u16(std::vector<uint8_t>& out, uint16_t in) {
+        out.push_back(uint8_t(in));
+        out.push_back(uint8_t(in >> 8));
+    }
+    void u32(std::vector<uint8_t>& out, uint32_t in) {
+        u16(out, uint16_t(in));
+        u16(out, uint16_t(in >> 16));
+    }
+    void name(std::vector<uint8_t>& out, std::string_view in) {
+        in = in.substr(0, UINT16_MAX);
+        u16(out, uint16_t(in.size()));
+        out.insert(out.end(), in.begin(), in.end());
+    }
+}
+
+std::vector<uint8_t> serializeSourceMap(const AssembleResult& in)
+{
+    std::vector<uint8_t> out {'C', '8', 'S', 'M'};
+    out.reserve(16 + in.files.size() * 32 + in.symbols.size() * 24 + in.locations.size() * 8);
+    u16(out, sourceMapVersion);
+
+    u16(out, uint16_t(in.files.size()));
+    for(const auto& file : in.files)
+        name(out, file);
+
+    // labels are emitted in program order, so they already are sorted by address
+    u16(out, uint16_t(in.symbols.size()));
+    for(const auto& symbol : in.symbols) {
+        u16(out, symbol.address);
+        name(out, symbol.name);
+    }
+
+    u32(out, uint32_t(in.locations.size()));
+    for(const auto& location : in.locations) {
+        u16(out, location.address);
+        u16(out, location.file);
+        u32(out, uint32_t(location.line));
+    }
+    return out;
+}
@@ -0,0 +1,60 @@
+#include "symbolInterner.hpp"
+
+SymbolInterner::SymbolInterner() : slots(256, invalidId)
+{
+}
+
+uint32_t SymbolInterner::hash(std::string_view name)
+{
+    uint32_t result = 2166136261u; // FNV-1a
+    for(auto charIt : name) {
+        result ^= uint8_t(charIt);
+        result *= 16777619u;
+    }
+    return result;
+}
+
+uint32_t SymbolInterner::find(std::string_view name) const
+{
+    const size_t mask = slots.size() - 1;
+    for(size_t slotIdx = hash(name) & mask; slots[slotIdx] != invalidId; slotIdx = (slotIdx + 1) & mask)
+    {
+        if(names[slots[slotIdx]] == name)
+            return slots[slotIdx];
+    }
+    return invalidId;
+}
+
+uint32_t SymbolInterner::intern(std::string_view name)
+{
+    const size_t mask = slots.size() - 1;
+    size_t slotIdx = hash(name) & mask;
+    for(; slots[slotIdx] != invalidId; slotIdx = (slotIdx + 1) & mask)
+    {
+        if(names[slots[slotIdx]] == name)
+            return slots[slotIdx];
+    }
+
+    const auto id = uint32_t(names.size());
+    names.push_back(name);
+    slots[slotIdx] = id;
+
+    if(names.size() * 2 > slots.size()) // keep load factor under 0.5
+        grow();
+
+    return id;
+}
+
+void SymbolInterner::grow()
+{
+    slots.assign(slots.size() * 2, invalidId);
+    const size_t mask = slots.size() - 1;
+
+    for(uint32_t id = 0; id != names.size(); id++)
+    {
+        size_t slotIdx = hash(names[id]) & mask;
+        while(slots[slotIdx] != invalidId)
+            slotIdx = (slotIdx + 1) & mask;
+        slots[slotIdx] = id;
+    }
+}
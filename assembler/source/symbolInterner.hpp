@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// maps every distinct identifier to a dense integer id, so later stages compare and index by id
+// interned names are views, the text they point to must outlive the interner
+class SymbolInterner
+{
+public:
+    static constexpr uint32_t invalidId = UINT32_MAX;
+
+    SymbolInterner();
+
+    uint32_t intern(std::string_view name);
+    uint32_t find(std::string_view name) const;
+
+    std::string_view name(uint32_t id) const { return names[id]; }
+    size_t size() const { return names.size(); }
+
+protected:
+    static uint32_t hash(std::string_view name);
+    void grow();
+
+protected:
+    std::vector<std::string_view> names {};
+    std::vector<uint32_t> slots {}; // open addressing with linear probing, holds ids
+};
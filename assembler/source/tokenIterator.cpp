@@ -1,8 +1,65 @@
 #include "tokenIterator.hpp"
 #include <algorithm>
-#include <stack>
 #include <ostream>
 
+namespace
+{
+    enum CharClass : uint8_t {
+        Space       = 1 << 0,
+        Digit       = 1 << 1,
+        HexLetter   = 1 << 2,
+        Letter      = 1 << 3,
+        Underscore  = 1 << 4,
+    };
+
+    constexpr std::array<uint8_t,256> charClasses = [] {
+        std::array<uint8_t,256> result {};
+        for(int charIt = 0; charIt != 256; charIt++)
+        {
+            if(charIt == ' ' || charIt == '\t' || charIt == '\n' || charIt == '\v' || charIt == '\f' || charIt == '\r')
+                result[charIt] |= Space;
+            if(charIt >= '0' && charIt <= '9')
+                result[charIt] |= Digit;
+            if((charIt >= 'a' && charIt <= 'f') || (charIt >= 'A' && charIt <= 'F'))
+                result[charIt] |= HexLetter;
+            if((charIt >= 'a' && charIt <= 'z') || (charIt >= 'A' && charIt <= 'Z'))
+                result[charIt] |= Letter;
+            if(charIt == '_')
+                result[charIt] |= Underscore;
+        }
+        return result;
+    }();
+
+    bool is(char charIt, uint8_t classes) {
+        return charClasses[uint8_t(charIt)] & classes;
+    }
+
+    constexpr uint32_t maxNumber = 0xFFFF;
+
+    // accumulates digits of given base, stopping at the first one that doesn't belong to it (like std::stoi);
+    // a value past maxNumber is reported through tooLarge and clamped, nothing in a chip8 program is wider
+    int parseDigits(std::string_view digits, int base, bool& tooLarge)
+    {
+        uint32_t result {};
+        for(auto charIt : digits)
+        {
+            uint32_t digit {};
+            if(is(charIt, Digit)) digit = charIt - '0';
+            else if(charIt >= 'a' && charIt <= 'f') digit = charIt - 'a' + 10;
+            else if(charIt >= 'A' && charIt <= 'F') digit = charIt - 'A' + 10;
+            else break;
+
+            if(digit >= uint32_t(base)) break;
+            result = result * uint32_t(base) + digit;
+            if(result > maxNumber) {
+                tooLarge = true;
+                return int(maxNumber);
+            }
+        }
+        return int(result);
+    }
+}
+
 std::ostream& operator<<(std::ostream& os, const Token::type& in)
 {
     if (const auto* typedToken = std::get_if<Token::End>(&in)) {
@@ -23,22 +80,29 @@ std::ostream& operator<<(std::ostream& os, const Token::type& in)
     return os;
 }
 
-TokenIterator::TokenIterator(const std::string& inSource) : source(inSource)
+TokenIterator::TokenIterator(std::string_view inSource, SymbolInterner& inSymbols) : source(inSource), symbols(inSymbols)
 {
 }
 
-void TokenIterator::addOperator(const std::string& in_value)
+void TokenIterator::addOperator(std::string_view in_value)
 {
-    if(std::find(registeredOperats.begin(),registeredOperats.end(), in_value) != registeredOperats.end())
+    if(in_value.empty())
         return;
 
-    registeredOperats.push_back(in_value);
+    auto& candidates = operatorsByFirstChar[uint8_t(in_value[0])];
+    const uint32_t symbol = symbols.intern(in_value);
+    if(std::find(candidates.begin(),candidates.end(), symbol) != candidates.end())
+        return;
+
+    candidates.push_back(symbol);
+    std::stable_sort(candidates.begin(),candidates.end(), [this](uint32_t lhs, uint32_t rhs) {
+        return symbols.name(lhs).size() > symbols.name(rhs).size(); // keep longer match first
+    });
 }
 
 const Token::type& TokenIterator::next()
 {
-    auto beginIdx = positionIdx;
-    while(source[positionIdx] != '\0')
+    while(positionIdx < source.size())
     {
         auto charIt = source[positionIdx];
 
@@ -49,7 +113,7 @@ const Token::type& TokenIterator::next()
             continue;
         }
 
-        if(isspace(charIt)) // ignore whitespace
+        if(is(charIt, Space)) // ignore whitespace
         {
             positionIdx++;
             continue;
@@ -82,68 +146,35 @@ const Token::type& TokenIterator::next()
 
 bool TokenIterator::tryTokenizeNumber()
 {
-    if(!isdigit(source[positionIdx])) return false;
+    if(!is(source[positionIdx], Digit)) return false;
 
-    std::string summed;
-    while(positionIdx != source.size())
+    const auto beginIdx = positionIdx;
+    while(positionIdx < source.size())
     {
         auto charIt = source[positionIdx];
 
-        if(isdigit(charIt) || charIt=='A' || charIt=='B' || charIt=='C' || charIt=='D' || charIt=='E' || charIt=='F'
-           || charIt=='a' || charIt=='b' || charIt=='c' || charIt=='d' || charIt=='e' || charIt=='f')
-        {
-            summed += charIt;
+        if(is(charIt, Digit | HexLetter))
             positionIdx++;
-        }
-        else if( summed.size() == 1 && charIt == 'x' or charIt == 'b')
-        {
-            summed += charIt;
+        else if(positionIdx - beginIdx == 1 && charIt == 'x')
             positionIdx++;
-        }
         else
-        {
             break;
-        }
     }
 
-    if(summed[0] == '0') {
-        if (summed.size() > 1 && summed[1] == 'x') {
-            if (summed.size() == 2)
-            {
-                currentToken = Token::Number{currentLine,0};
-                return true;
-            }
-            else
-            {
-                currentToken = Token::Number{currentLine,std::stoi(summed.c_str() + 2, nullptr, 16)};
-                return true;
-            }
-        }
-        else if (summed.size() > 1 && summed[1] == 'b') {
-            if (summed.size() == 2)
-            {
-                currentToken = Token::Number{currentLine,0};
-                return true;
-            }
-            else
-            {
-                currentToken = Token::Number{currentLine,std::stoi(summed.c_str() + 2, nullptr, 2)};
-                return true;
-            }
-        }
-        else if (summed.size() == 1)
-        {
-            currentToken = Token::Number{currentLine,0};
-            return true;
-        }
-        else
-        {
-            currentToken = Token::Number{currentLine,std::stoi(summed.c_str() + 1, nullptr, 8)};
-            return true;
-        }
-    }
+    const std::string_view summed = source.substr(beginIdx, positionIdx - beginIdx);
+
+    int value {};
+    bool tooLarge {};
+    if(summed.size() > 1 && summed[0] == '0' && summed[1] == 'x')
+        value = parseDigits(summed.substr(2), 16, tooLarge);
+    else if(summed.size() > 1 && summed[0] == '0' && summed[1] == 'b')
+        value = parseDigits(summed.substr(2), 2, tooLarge);
+    else if(summed[0] == '0')
+        value = parseDigits(summed.substr(1), 8, tooLarge);
+    else
+        value = parseDigits(summed, 10, tooLarge);
 
-    currentToken = Token::Number{currentLine,std::stoi(summed)};
+    currentToken = Token::Number{{{currentLine},value}, summed, tooLarge};
     return true;
 }
 
@@ -154,7 +185,7 @@ bool TokenIterator::tryTokenizeString()
     auto beginIdx = positionIdx;
     positionIdx++;
 
-    while(source[positionIdx] != '\0')
+    while(positionIdx < source.size())
     {
         auto prevCharIt = source[positionIdx-1];
         auto charIt = source[positionIdx];
@@ -162,38 +193,29 @@ bool TokenIterator::tryTokenizeString()
         if(charIt == '"' && prevCharIt != '\\') // allow escape code
             break;
 
+        if(charIt == '\n')
+            currentLine++;
+
         positionIdx++;
     }
-    positionIdx++; // escape string
-    currentToken = Token::String{currentLine,source.substr(beginIdx,positionIdx-beginIdx)};
+    positionIdx = std::min(positionIdx + 1, source.size()); // escape string
+    currentToken = Token::String{{{currentLine},source.substr(beginIdx,positionIdx-beginIdx)}};
     return true;
 }
 
 bool TokenIterator::tryTokenizeOperator()
 {
-    auto beginIdx = positionIdx;
-
-    std::string matched {};
-    for(auto& operatIt : registeredOperats)
+    for(const uint32_t symbol : operatorsByFirstChar[uint8_t(source[positionIdx])])
     {
-        bool match {true};
-        for(int operatCharIdx = 0; operatCharIdx != operatIt.size();operatCharIdx++)
-        {
-            if(source[beginIdx+operatCharIdx] != operatIt[operatCharIdx])
-            {
-                match = false;
-                break;
-            }
-        }
-        if(!match) continue;
-        if(matched.size() < operatIt.size()) matched = operatIt; // keep longer match
-    }
-
-    if(matched.empty()) return false;
+        const auto operatorName = symbols.name(symbol);
+        if(source.compare(positionIdx, operatorName.size(), operatorName) != 0)
+            continue;
 
-    positionIdx += matched.size();
-    currentToken = Token::Operator{currentLine,matched};
-    return true;
+        currentToken = Token::Operator{{{{currentLine},source.substr(positionIdx,operatorName.size())},symbol}};
+        positionIdx += operatorName.size();
+        return true;
+    }
+    return false;
 }
 
 const Token::type& TokenIterator::current()
@@ -203,22 +225,14 @@ const Token::type& TokenIterator::current()
 
 bool TokenIterator::tryTokenizeLabel()
 {
-    if(!((source[positionIdx] >= 'a' && source[positionIdx] <= 'z') || (source[positionIdx] >= 'A' && source[positionIdx] <= 'Z')))
+    if(!is(source[positionIdx], Letter))
         return false;
 
     auto beginIdx = positionIdx;
-    while(source[positionIdx] != '\0')
-    {
-        auto charIt = source[positionIdx];
-
-        if ((charIt >= '0' && charIt <= '9') || (charIt >= 'A' && charIt <= 'Z') ||
-            (charIt >= 'a' && charIt <= 'z') || charIt == '_')
-        {
-            positionIdx++;
-        } else break;
-    }
+    while(positionIdx < source.size() && is(source[positionIdx], Digit | Letter | Underscore))
+        positionIdx++;
 
-    currentToken = Token::Label{currentLine,source.substr(beginIdx,positionIdx-beginIdx)};
+    const auto value = source.substr(beginIdx,positionIdx-beginIdx);
+    currentToken = Token::Label{{{{currentLine},value},symbols.intern(value)}};
     return true;
 }
-
@@ -1,8 +1,10 @@
 #pragma once
 
-#include <string>
+#include <array>
+#include <string_view>
 #include <vector>
 #include <variant>
+#include "symbolInterner.hpp"
 
 
 
@@ -18,13 +20,27 @@ namespace Token
         T value;
     };
 
+    // value views into the source buffer, symbol is the id interned in the SymbolInterner
+    template<typename T>
+    struct WithSymbol : public WithValue<T>
+    {
+        uint32_t symbol {SymbolInterner::invalidId};
+    };
+
     struct End      : public Base {};
-    struct Operator : public WithValue<std::string> {};
-    struct Label    : public WithValue<std::string> {};
-    struct String   : public WithValue<std::string> {};
-    struct Number   : public WithValue<int> {};
+    struct Operator : public WithSymbol<std::string_view> {};
+    struct Label    : public WithSymbol<std::string_view> {};
+    struct String   : public WithValue<std::string_view> {};
+    struct Number   : public WithValue<int> {
+        std::string_view text {};   // as written in the source
+        bool tooLarge {};           // past 0xFFFF, value is clamped
+    };
 
     using type = std::variant<End,Operator,Label,String,Number>;
+
+    inline int lineOf(const type& in) {
+        return std::visit([](const Base& typedToken) { return typedToken.line; }, in);
+    }
 }
 
 std::ostream& operator<<(std::ostream& os, const Token::type& in);
@@ -32,9 +48,9 @@ std::ostream& operator<<(std::ostream& os, const Token::type& in);
 class TokenIterator
 {
 public:
-    explicit TokenIterator(const std::string& inSource);
+    TokenIterator(std::string_view inSource, SymbolInterner& inSymbols);
 
-    void addOperator(const std::string& in_value);
+    void addOperator(std::string_view in_value);
 
     const Token::type& next();
     const Token::type& current();
@@ -45,10 +61,13 @@ protected:
     bool tryTokenizeOperator();
     bool tryTokenizeLabel();
 protected:
-    const std::string& source;
+    std::string_view source;
+    SymbolInterner& symbols;
     int currentLine {1};
 
     size_t positionIdx {};
     Token::type currentToken {};
-    std::vector<std::string> registeredOperats {};
+
+    // operators indexed by their first character, longest first
+    std::array<std::vector<uint32_t>,256> operatorsByFirstChar {};
 };
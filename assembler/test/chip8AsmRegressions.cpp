@@ -0,0 +1,87 @@
+// chip8AsmRegressions: sources that once assembled wrong, each checked against what it has to assemble to
+
+#include <cstdlib>
+#include <iostream>
+#include <string_view>
+#include <vector>
+#include "chip8asm.hpp"
+
+namespace
+{
+    int failures {};
+
+    void check(bool condition, std::string_view name, std::string_view what)
+    {
+        if(condition)
+            return;
+        std::cout << name << ": " << what << "\n";
+        failures++;
+    }
+
+    // -s has to leave the rom as it is: arr_1 is only reached by indexing past arr, which Fx55 writes through,
+    // it used to be folded into sprite and CODE moved under that write
+    void shrinkKeepsIndexedData()
+    {
+        constexpr std::string_view name = "shrinkKeepsIndexedData";
+        constexpr std::string_view source =
+            "jp CODE\n"
+            ":sprite\n db 1\n db 2\n db 3\n"
+            ":arr\n db 9\n"
+            ":arr_1\n db 2\n db 3\n"
+            ":CODE\n"
+            " ld regI sprite\n drw reg0 reg0 3\n"
+            " ld regI arr\n ld *regI upTo reg2\n"
+            " jp CODE\n";
+
+        const std::vector<uint8_t> expected {
+            0x12, 0x08, 0x01, 0x02, 0x03, 0x09, 0x02, 0x03,
+            0xA2, 0x02, 0xD0, 0x03, 0xA2, 0x05, 0xF2, 0x55, 0x12, 0x08
+        };
+        const auto plain = assemble(source);
+        check(plain.success() && plain.bytes == expected, name, "wrong rom without -s");
+
+        AssembleOptions options {};
+        options.shrink = true;
+        const auto shrunk = assemble(source, options);
+        check(shrunk.success() && shrunk.bytes == expected, name, "-s changed the rom");
+    }
+
+    // literals past 16 bits overflowed an int while being parsed and assembled to whatever was left of them
+    void rejectsWideNumbers()
+    {
+        constexpr std::string_view name = "rejectsWideNumbers";
+        check(!assemble("ld reg0 4294967297\n").success(), name, "ld reg0 4294967297 assembled");
+        check(!assemble("db 0x100000001\n").success(), name, "db 0x100000001 assembled");
+        check(!assemble("ld regI 65536\n").success(), name, "ld regI 65536 assembled");
+
+        const auto widest = assemble("ld reg0 0xFFFF\n");
+        check(widest.success() && widest.bytes == std::vector<uint8_t>{0x60, 0xFF}, name, "0xFFFF rejected");
+    }
+
+    // -O went around a cycle of jumps, rethreading every one of them on every pass; a cycle stays as written
+    void jumpCycleStaysAsWritten()
+    {
+        constexpr std::string_view name = "jumpCycleStaysAsWritten";
+        AssembleOptions options {};
+        options.optimize = true;
+        const auto cycle = assemble("jp A\n:A\n jp B\n:B\n jp C\n:C\n jp A\n", options);
+        const std::vector<uint8_t> expected { 0x12, 0x02, 0x12, 0x04, 0x12, 0x06, 0x12, 0x02 };
+        check(cycle.success() && cycle.bytes == expected, name, "the cycle was rethreaded");
+
+        // a chain into a loop is still threaded up to where the loop starts
+        const auto chain = assemble("jp X\n:X\n jp Y\n:Y\n jp Z\n:Z\n cls\n jp Z\n", options);
+        check(chain.success() && chain.bytes == std::vector<uint8_t>{ 0x12, 0x02, 0x00, 0xE0, 0x12, 0x02 }, name, "the chain wasn't threaded");
+    }
+}
+
+int main()
+{
+    shrinkKeepsIndexedData();
+    rejectsWideNumbers();
+    jumpCycleStaysAsWritten();
+
+    if(failures != 0)
+        return EXIT_FAILURE;
+    std::cout << "all passed\n";
+    return EXIT_SUCCESS;
+}
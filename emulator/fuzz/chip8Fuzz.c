@@ -0,0 +1,59 @@
+#include "chip8.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// libFuzzer / AFL++ harness for the interpreter
+// input: [frame count n][n little endian uint16 key masks, one per frame][rom, loaded at 0x200]
+// every frame runs INSTRUCTIONS_PER_FRAME instructions with its key mask held, then chip8_fixedUpdate;
+// frames past the script hold no key, the run ends after MAX_FRAMES frames
+
+#define INSTRUCTIONS_PER_FRAME 500
+#define MAX_FRAMES 40
+
+int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    // one instance for the whole session, reset in place: chip8_initialize is a copy of the power-on state and the
+    // pages written by the last rom are reused, nothing is allocated per input
+    static Chip8* c = NULL;
+    if (c == NULL)
+        c = chip8_allocate();
+    chip8_initialize(c);
+
+    if (size < 1)
+        return 0;
+    const size_t frames = data[0];
+    const size_t scriptSize = 1 + frames * 2;
+    if (size < scriptSize)
+        return 0;
+    if (!chip8_loadProgramFromMemory(c, data + scriptSize, (long)(size - scriptSize)))
+        return 0;
+
+    for(size_t frame = 0; frame != MAX_FRAMES; frame++) {
+        const uint16_t keys = frame < frames ? (uint16_t)(data[1 + frame * 2] | data[2 + frame * 2] << 8) : 0;
+        chip8_setKeys(c, keys);
+        for(int idx = 0; idx != INSTRUCTIONS_PER_FRAME; idx++)
+            chip8_preformNextInstruction(c);
+        chip8_fixedUpdate(c);
+    }
+    return 0;
+}
+
+#ifdef CHIP8_FUZZ_STANDALONE
+// replays inputs given on the command line, for reproducing a crash or fuzzing with a plain afl-gcc build
+int main(int argc, char** argv) {
+    static uint8_t input[1 + 255 * 2 + 4096];
+    for(int arg = 1; arg < argc; arg++) {
+        FILE* file = fopen(argv[arg], "rb");
+        if (file == NULL) {
+            printf("ERROR: can't open %s\n", argv[arg]);
+            return EXIT_FAILURE;
+        }
+        const size_t size = fread(input, 1, sizeof(input), file);
+        fclose(file);
+        LLVMFuzzerTestOneInput(input, size);
+    }
+    return EXIT_SUCCESS;
+}
+#endif
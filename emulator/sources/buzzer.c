@@ -0,0 +1,113 @@
+#include "buzzer.h"
+
+#include <math.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+
+#define QUEUE_SIZE 256              // a power of two
+#define EDGES_PER_TAKE 16
+#define WAVETABLE_BITS 8
+#define WAVETABLE_SIZE (1 << WAVETABLE_BITS)
+#define AMPLITUDE 8000.0f
+#define FRAMES_PER_SECOND 60
+
+// emulated time is mapped to audio time by an offset; it is set so that an edge plays LEAD_FRAMES after the audio
+// thread sees it (edges arrive once their frame is over), by the first edge and again when the emulation drifted
+// (turbo, a stall, a frame rate a bit off 60 Hz): at the start of a beep more than MAX_DRIFT_FRAMES off,
+// or for any edge more than MAX_DRIFT_FRAMES late or MAX_AHEAD_FRAMES early
+#define LEAD_FRAMES 1
+#define MAX_DRIFT_FRAMES 4
+#define MAX_AHEAD_FRAMES 30
+
+typedef struct {
+    uint64_t time;                  // emulated samples since the first frame
+    bool on;
+} BuzzerEvent;
+
+struct Buzzer {
+    uint32_t samplesPerFrame;
+    uint32_t phaseStep;             // a turn of the wavetable is 2^32
+    int16_t wavetable[WAVETABLE_SIZE];
+
+    BuzzerEvent events[QUEUE_SIZE];
+    _Atomic uint32_t head;          // written by the emulation thread only
+    _Atomic uint32_t tail;          // written by the audio thread only
+
+    // audio thread
+    uint64_t renderedSamples;
+    int64_t offset;
+    bool anchored;
+    bool on;
+    uint32_t phase;
+};
+
+Buzzer* buzzer_allocate(uint32_t sampleRate, float frequency) {
+    Buzzer* b = calloc(1, sizeof(Buzzer));
+    b->samplesPerFrame = sampleRate / FRAMES_PER_SECOND;
+    b->phaseStep = (uint32_t)(frequency / (float)sampleRate * 4294967296.0f);
+    for(int idx = 0; idx != WAVETABLE_SIZE; idx++)
+        b->wavetable[idx] = (int16_t)(AMPLITUDE * sinf(2.0f * 3.14159265f * (float)idx / WAVETABLE_SIZE));
+    atomic_init(&b->head, 0);
+    atomic_init(&b->tail, 0);
+    return b;
+}
+
+void buzzer_deallocate(Buzzer* b) {
+    free(b);
+}
+
+void buzzer_takeEdges(Buzzer* b, Chip8* c) {
+    Chip8BuzzerEdge edges[EDGES_PER_TAKE];
+    uint32_t count;
+    while ((count = chip8_takeBuzzerEdges(c, edges, EDGES_PER_TAKE)) != 0) {
+        uint32_t head = atomic_load_explicit(&b->head, memory_order_relaxed);
+        const uint32_t tail = atomic_load_explicit(&b->tail, memory_order_acquire);
+        for(uint32_t idx = 0; idx != count; idx++) {
+            // nobody plays them while the queue is full, dropping is fine
+            if (head - tail == QUEUE_SIZE)
+                break;
+            const Chip8BuzzerEdge* edge = &edges[idx];
+            const uint64_t within = edge->frameInstructions != 0 ? (uint64_t)edge->instruction * b->samplesPerFrame / edge->frameInstructions : 0;
+            b->events[head % QUEUE_SIZE] = (BuzzerEvent){ edge->frame * b->samplesPerFrame + within, edge->on };
+            head++;
+        }
+        atomic_store_explicit(&b->head, head, memory_order_release);
+    }
+}
+
+void buzzer_render(Buzzer* b, int16_t* out, uint32_t frames) {
+    const uint32_t head = atomic_load_explicit(&b->head, memory_order_acquire);
+    uint32_t tail = atomic_load_explicit(&b->tail, memory_order_relaxed);
+    const int64_t lead = (int64_t)b->samplesPerFrame * LEAD_FRAMES;
+    const int64_t maxDrift = (int64_t)b->samplesPerFrame * MAX_DRIFT_FRAMES;
+    const int64_t maxAhead = (int64_t)b->samplesPerFrame * MAX_AHEAD_FRAMES;
+
+    for(uint32_t idx = 0; idx != frames; idx++) {
+        const int64_t now = (int64_t)(b->renderedSamples + idx);
+        while (tail != head) {
+            const BuzzerEvent* event = &b->events[tail % QUEUE_SIZE];
+            int64_t due = (int64_t)event->time + b->offset;
+            const bool beepStart = event->on && !b->on;
+            const bool drifted = beepStart ? due > now + lead + maxDrift || due < now + lead - maxDrift
+                                           : due > now + maxAhead || due < now - maxDrift;
+            if (!b->anchored || drifted) {
+                b->offset = now + lead - (int64_t)event->time;
+                b->anchored = true;
+                due = now + lead;
+            }
+            if (due > now)
+                break;
+            if (beepStart)
+                b->phase = 0;   // beeps start on a zero crossing
+            b->on = event->on;
+            tail++;
+        }
+
+        out[idx] = b->on ? b->wavetable[b->phase >> (32 - WAVETABLE_BITS)] : 0;
+        if (b->on)
+            b->phase += b->phaseStep;
+    }
+
+    b->renderedSamples += frames;
+    atomic_store_explicit(&b->tail, tail, memory_order_release);
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include <stdint.h>
+#include "chip8.h"
+
+// buzzer synthesis for the audio callback: the emulation thread pushes the core's buzzer edges into a lock-free
+// single producer / single consumer queue, the audio thread plays them at their sample from a wavetable
+
+struct Buzzer;
+typedef struct Buzzer Buzzer;
+
+Buzzer* buzzer_allocate(uint32_t sampleRate, float frequency);
+void buzzer_deallocate(Buzzer*);
+
+// emulation thread, after chip8_fixedUpdate: moves the edges of the frames that ended out of the core
+void buzzer_takeEdges(Buzzer*, Chip8* c);
+
+// audio thread: renders frames samples of 16 bit mono
+void buzzer_render(Buzzer*, int16_t* out, uint32_t frames);
@@ -1,8 +1,14 @@
 #include "chip8.h"
 
 #include <assert.h>
+#include <stdalign.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
 
 #define STACK_SIZE 16
 #define MEMORY_SIZE 4096
@@ -15,12 +21,25 @@
 #define FRAMEBUFFER_X 64
 #define FRAMEBUFFER_Y 32
 
+#define CACHE_LINE 64
+
+#define BUZZER_EDGE_CAPACITY 16
+
 #define DEBUG_PRINT false
 
+// memory is read through a table of pages; pages start out shared (the font, a rom loaded into a pool template, zeroes)
+// and one is copied into a private page of the instance on its first write, so instances running the same rom only
+// own the few pages Fx33/Fx55 wrote to
+#define PAGE_BITS 8
+#define PAGE_SIZE (1 << PAGE_BITS)
+#define PAGE_COUNT (MEMORY_SIZE / PAGE_SIZE)
+#define ALL_PAGES ((1u << PAGE_COUNT) - 1)
+
+// one instance is a few cache lines of cpu state followed by the page table and screen: the registers every
+// instruction touches share the first line, calls, returns and key tests the second, the screen is only ever touched
+// a few pixels at a time; everything before breakpoints is guest state, restored from a template on reset
 struct Chip8 {
-    int tickFromFixedUpdate;
-
-    uint8_t v_reg[GENERAL_REG_SIZE];
+    alignas(CACHE_LINE) uint8_t v_reg[GENERAL_REG_SIZE];
     uint16_t i_reg;
     uint16_t pc_reg;
 
@@ -28,196 +47,296 @@ struct Chip8 {
     uint8_t delay_timer;
     uint8_t sound_timer;
 
-    uint16_t stack[STACK_SIZE];
-    uint8_t memory[MEMORY_SIZE];
-    uint32_t screen[FRAMEBUFFER_Y][FRAMEBUFFER_X];
+    uint16_t drawn_pixels;              // pixels flipped by the last instruction
+    uint16_t shared_pages;              // bit n set while pages[n] is shared, written pages are copied first
+    int tickFromFixedUpdate;
+    int resume_address;                 // breakpoint chip8_run stopped at, executed by the next run
 
+    alignas(CACHE_LINE) uint16_t stack[STACK_SIZE];
     bool key[KEY_SIZE];
     bool prev_key[KEY_SIZE];
+
+    alignas(CACHE_LINE) const uint8_t* pages[PAGE_COUNT];
+    uint32_t screen[FRAMEBUFFER_Y][FRAMEBUFFER_X];
+
+    // debugging and profiling aids, not guest state: kept by chip8_initialize and pool resets
+    uint8_t breakpoints[MEMORY_SIZE / 8];
+    uint16_t call_stack[STACK_SIZE];    // entry address of the routine each stack slot returns from
+    bool track_calls;
+
+    // buzzer edges not taken yet; frames keep counting across resets, the time of an edge only ever grows
+    uint64_t frame_count;
+    Chip8BuzzerEdge buzzer_edges[BUZZER_EDGE_CAPACITY];
+    uint8_t buzzer_edge_count;
+
+    // private pages, allocated on the first write to a page and reused after a reset
+    uint8_t* owned_pages[PAGE_COUNT];
+};
+
+static_assert(offsetof(Chip8, stack) == CACHE_LINE, "registers don't fit in one cache line");
+static_assert(0x200 % PAGE_SIZE == 0, "programs are loaded at the start of a page");
+
+#define GUEST_STATE_SIZE offsetof(Chip8, breakpoints)
+
+static const uint8_t fontPage[PAGE_SIZE] = {
+        0b11100000, 0b10100000, 0b10100000, 0b10100000, 0b11100000,   // 0
+        0b01000000, 0b01000000, 0b01000000, 0b01000000, 0b01000000,   // 1
+        0b11100000, 0b00100000, 0b11100000, 0b10000000, 0b11100000,   // 2
+        0b11100000, 0b00100000, 0b11100000, 0b00100000, 0b11100000,   // 3
+        0b10000000, 0b10100000, 0b10100000, 0b11100000, 0b00100000,   // 4
+        0b11100000, 0b10000000, 0b11100000, 0b00100000, 0b11100000,   // 5
+        0b11100000, 0b10000000, 0b11100000, 0b10100000, 0b11100000,   // 6
+        0b11100000, 0b00100000, 0b00100000, 0b00100000, 0b00100000,   // 7
+        0b11100000, 0b10100000, 0b11100000, 0b10100000, 0b11100000,   // 8
+        0b11100000, 0b10100000, 0b11100000, 0b00100000, 0b11100000,   // 9
+        0b11100000, 0b10100000, 0b11100000, 0b10100000, 0b10100000,   // A
+        0b11000000, 0b10100000, 0b11100000, 0b10100000, 0b11000000,   // B
+        0b11100000, 0b10000000, 0b10000000, 0b10000000, 0b11100000,   // C
+        0b11000000, 0b10100000, 0b10100000, 0b10100000, 0b11000000,   // D
+        0b11100000, 0b10000000, 0b11100000, 0b10000000, 0b11100000,   // E
+        0b11100000, 0b10000000, 0b11000000, 0b10000000, 0b10000000,   // F
+};
+
+static const uint8_t zeroPage[PAGE_SIZE];
+
+// power-on state, copied whole instead of clearing and filling an instance field by field
+static const Chip8 powerOn = {
+    .pc_reg = 0x200,
+    .resume_address = -1,
+    .shared_pages = ALL_PAGES,
+    .pages = {
+        fontPage, zeroPage, zeroPage, zeroPage, zeroPage, zeroPage, zeroPage, zeroPage,
+        zeroPage, zeroPage, zeroPage, zeroPage, zeroPage, zeroPage, zeroPage, zeroPage,
+    },
+    .screen[2][2] = 1,
 };
 
+static void* allocateAligned(size_t size) {
+#ifdef _WIN32
+    return _aligned_malloc(size, CACHE_LINE);
+#else
+    return aligned_alloc(CACHE_LINE, size);
+#endif
+}
+
+static void freeAligned(void* block) {
+#ifdef _WIN32
+    _aligned_free(block);
+#else
+    free(block);
+#endif
+}
+
+static void freeOwnedPages(Chip8* c) {
+    for(int page = 0; page != PAGE_COUNT; page++)
+        freeAligned(c->owned_pages[page]);
+}
+
+static inline uint8_t readByte(const Chip8* c, uint16_t address) {
+    address &= MEMORY_SIZE-1;
+    return c->pages[address >> PAGE_BITS][address & (PAGE_SIZE-1)];
+}
+
+// the page ready for writing, copied out of the shared one first if needed
+static uint8_t* writablePage(Chip8* c, int page) {
+    if (c->shared_pages & (1u << page)) {
+        if (c->owned_pages[page] == NULL)
+            c->owned_pages[page] = allocateAligned(PAGE_SIZE);
+        memcpy(c->owned_pages[page], c->pages[page], PAGE_SIZE);
+        c->pages[page] = c->owned_pages[page];
+        c->shared_pages &= ~(1u << page);
+    }
+    return c->owned_pages[page];
+}
+
+static inline void writeByte(Chip8* c, uint16_t address, uint8_t value) {
+    address &= MEMORY_SIZE-1;
+    writablePage(c, address >> PAGE_BITS)[address & (PAGE_SIZE-1)] = value;
+}
+
 Chip8* chip8_allocate() {
-    return malloc(sizeof(Chip8));
+    Chip8* c = allocateAligned(sizeof(Chip8));
+    memcpy(c, &powerOn, sizeof(Chip8));
+    return c;
+}
+
+static void recordBuzzerEdge(Chip8* c, bool on) {
+    // when nobody takes them, the newest edge replaces the last one, so the state they end in stays right
+    if (c->buzzer_edge_count == BUZZER_EDGE_CAPACITY)
+        c->buzzer_edge_count--;
+    c->buzzer_edges[c->buzzer_edge_count++] = (Chip8BuzzerEdge){ c->frame_count, (uint32_t)c->tickFromFixedUpdate, 0, on };
 }
 
 void chip8_initialize(Chip8* c) {
+    if (c->sound_timer != 0)
+        recordBuzzerEdge(c, false);
+    memcpy(c, &powerOn, GUEST_STATE_SIZE);
+}
 
-    c->tickFromFixedUpdate = 0;
+void chip8_deallocate(Chip8* c) {
+    if (c == NULL)
+        return;
+    freeOwnedPages(c);
+    freeAligned(c);
+}
 
-    for(int idx = 0; idx != GENERAL_REG_SIZE; idx++)
-        c->v_reg[idx] = 0;
+// the template is kept in front of the instances, in the same block; its pages are the pool's shared memory
+struct Chip8Pool {
+    size_t count;
+    Chip8* block;
+    uint8_t* memory;
+};
 
-    c->i_reg = 0;
-    c->pc_reg = 0x200;
+Chip8Pool* chip8_allocatePool(size_t count, const Chip8* powerOnState) {
+    Chip8Pool* pool = malloc(sizeof(Chip8Pool));
+    pool->count = count;
+    pool->block = allocateAligned((count + 1) * sizeof(Chip8));
+    pool->memory = allocateAligned(MEMORY_SIZE);
 
-    c->sp_reg = 0;
-    c->delay_timer = 0;
-    c->sound_timer = 0;
+    Chip8* base = &pool->block[0];
+    memcpy(base, powerOnState, sizeof(Chip8));
+    for(int page = 0; page != PAGE_COUNT; page++) {
+        memcpy(&pool->memory[page * PAGE_SIZE], powerOnState->pages[page], PAGE_SIZE);
+        base->pages[page] = &pool->memory[page * PAGE_SIZE];
+        base->owned_pages[page] = NULL;
+    }
+    base->shared_pages = ALL_PAGES;
 
-    for(int idx = 0; idx != KEY_SIZE; idx++) {
-        c->key[idx] = false;
-        c->prev_key[idx] = false;
-    }
-
-
-    for(int Yidx = 0; Yidx != FRAMEBUFFER_Y; Yidx++)
-        for(int Xidx = 0; Xidx != FRAMEBUFFER_X; Xidx++)
-            c->screen[Yidx][Xidx] = 0;
-
-    c->screen[2][2] = 1;
-
-    for(int idx = 0; idx != MEMORY_SIZE; idx++)
-        c->memory[idx] = 0;
-
-    static uint8_t font_data[] = {
-        0b11100000,
-        0b10100000,
-        0b10100000,
-        0b10100000,
-        0b11100000,
-
-        0b01000000,
-        0b01000000,
-        0b01000000,
-        0b01000000,
-        0b01000000,
-
-        0b11100000,
-        0b00100000,
-        0b11100000,
-        0b10000000,
-        0b11100000,
-
-        0b11100000,
-        0b00100000,
-        0b11100000,
-        0b00100000,
-        0b11100000,
-
-        0b10000000,
-        0b10100000,
-        0b10100000,
-        0b11100000,
-        0b00100000,
-
-        0b11100000,
-        0b10000000,
-        0b11100000,
-        0b00100000,
-        0b11100000,
-
-        0b11100000,
-        0b10000000,
-        0b11100000,
-        0b10100000,
-        0b11100000,
-
-        0b11100000,
-        0b00100000,
-        0b00100000,
-        0b00100000,
-        0b00100000,
-
-        0b11100000,
-        0b10100000,
-        0b11100000,
-        0b10100000,
-        0b11100000,
-
-        0b11100000,
-        0b10100000,
-        0b11100000,
-        0b00100000,
-        0b11100000,
-
-        0b11100000,
-        0b10100000,
-        0b11100000,
-        0b10100000,
-        0b10100000,
-
-        0b11000000,
-        0b10100000,
-        0b11100000,
-        0b10100000,
-        0b11000000,
-
-        0b11100000,
-        0b10000000,
-        0b10000000,
-        0b10000000,
-        0b11100000,
-
-        0b11000000,
-        0b10100000,
-        0b10100000,
-        0b10100000,
-        0b11000000,
-
-        0b11100000,
-        0b10000000,
-        0b11100000,
-        0b10000000,
-        0b11100000,
-
-        0b11100000,
-        0b10000000,
-        0b11000000,
-        0b10000000,
-        0b10000000,
-    };
-
-    for(int idx=0;idx != sizeof(font_data)/sizeof(uint8_t);idx++)
-        c->memory[idx] = font_data[idx];
+    for(size_t idx = 1; idx <= count; idx++)
+        memcpy(&pool->block[idx], base, sizeof(Chip8));
+    return pool;
 }
 
-void chip8_deallocate(Chip8* c) {
-    free(c);
+void chip8_deallocatePool(Chip8Pool* pool) {
+    if (pool == NULL)
+        return;
+    for(size_t idx = 1; idx <= pool->count; idx++)
+        freeOwnedPages(&pool->block[idx]);
+    freeAligned(pool->block);
+    freeAligned(pool->memory);
+    free(pool);
 }
 
-void chip8_loadProgramFromPath(Chip8* c , char* filename) {
-    long rom_length;
-    uint8_t *rom_buffer;
+size_t chip8_poolCount(const Chip8Pool* pool) {
+    return pool->count;
+}
 
-    FILE *rom = fopen(filename, "rb");
-    if (rom != NULL) {
-        // Get the size of the rom to allocate memory for a buffer
-        fseek(rom, 0, SEEK_END);
-        rom_length = ftell(rom);
-        rewind(rom);
+Chip8* chip8_poolInstance(Chip8Pool* pool, size_t idx) {
+    return &pool->block[idx + 1];
+}
 
-        rom_buffer = (uint8_t*) malloc(sizeof(uint8_t) * rom_length);
-        if (rom_buffer == NULL) {
-            printf("ERROR: Out of memory\n");
+void chip8_poolReset(Chip8Pool* pool, size_t idx) {
+    memcpy(&pool->block[idx + 1], &pool->block[0], GUEST_STATE_SIZE);
+}
 
-            exit(EXIT_FAILURE);
-        }
+void chip8_poolResetAll(Chip8Pool* pool) {
+    for(size_t idx = 1; idx <= pool->count; idx++)
+        memcpy(&pool->block[idx], &pool->block[0], GUEST_STATE_SIZE);
+}
 
-        fread(rom_buffer, sizeof(uint8_t), rom_length, rom);
+// the guest state of an instance, the buzzer edges it had not handed out yet and the contents of its private pages;
+// shared pages never change, they stay referenced
+struct Chip8State {
+    Chip8 core;
+    uint8_t pages[PAGE_COUNT][PAGE_SIZE];
+};
 
-        if ((0xFFF - 0x200) >= rom_length) {
-            for(int i = 0; i < rom_length; i++) {
-                c->memory[i + 0x200] = rom_buffer[i];
-            }
-        }
-        else {
-            printf("ERROR: ROM file too large\n");
-            exit(EXIT_FAILURE);
-        }
+Chip8State* chip8_allocateState() {
+    Chip8State* state = allocateAligned(sizeof(Chip8State));
+    memset(state, 0, sizeof(Chip8State));
+    return state;
+}
+
+void chip8_deallocateState(Chip8State* state) {
+    freeAligned(state);
+}
+
+void chip8_saveState(const Chip8* c, Chip8State* state) {
+    memcpy(&state->core, c, GUEST_STATE_SIZE);
+    state->core.frame_count = c->frame_count;
+    state->core.buzzer_edge_count = c->buzzer_edge_count;
+    memcpy(state->core.buzzer_edges, c->buzzer_edges, c->buzzer_edge_count * sizeof(Chip8BuzzerEdge));
+
+    for(int page = 0; page != PAGE_COUNT; page++)
+        if (!(c->shared_pages & (1u << page)))
+            memcpy(state->pages[page], c->pages[page], PAGE_SIZE);
+}
 
+void chip8_loadState(Chip8* c, const Chip8State* state) {
+    memcpy(c, &state->core, GUEST_STATE_SIZE);
+    c->frame_count = state->core.frame_count;
+    c->buzzer_edge_count = state->core.buzzer_edge_count;
+    memcpy(c->buzzer_edges, state->core.buzzer_edges, state->core.buzzer_edge_count * sizeof(Chip8BuzzerEdge));
+
+    // the page table still points at the private pages of the saved instance, which may not be this one
+    for(int page = 0; page != PAGE_COUNT; page++) {
+        if (c->shared_pages & (1u << page))
+            continue;
+        if (c->owned_pages[page] == NULL)
+            c->owned_pages[page] = allocateAligned(PAGE_SIZE);
+        memcpy(c->owned_pages[page], state->pages[page], PAGE_SIZE);
+        c->pages[page] = c->owned_pages[page];
     }
-    else {
+}
+
+void chip8_loadProgramFromPath(Chip8* c , char* filename) {
+    FILE *rom = fopen(filename, "rb");
+    if (rom == NULL) {
         printf("ERROR: ROM file does not exist\n");
         exit(EXIT_FAILURE);
     }
 
+    fseek(rom, 0, SEEK_END);
+    const long rom_length = ftell(rom);
+    rewind(rom);
+
+    if (rom_length < 0 || (0xFFF - 0x200) < rom_length) {
+        printf("ERROR: ROM file too large\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // straight into program memory a page at a time, no intermediate buffer
+    for(long offset = 0; offset < rom_length; offset += PAGE_SIZE) {
+        const long chunk = rom_length - offset < PAGE_SIZE ? rom_length - offset : PAGE_SIZE;
+        if (fread(writablePage(c, (0x200 + offset) >> PAGE_BITS), sizeof(uint8_t), chunk, rom) != (size_t)chunk) {
+            printf("ERROR: couldn't read the whole ROM\n");
+            fclose(rom);
+            exit(EXIT_FAILURE);
+        }
+    }
     fclose(rom);
-    free(rom_buffer);
+}
+
+bool chip8_loadProgramFromMemory(Chip8* c, const uint8_t* rom, long length) {
+    if (length < 0 || (0xFFF - 0x200) < length) {
+        printf("ERROR: ROM too large\n");
+        return false;
+    }
+
+    for(long i = 0; i < length; i++)
+        writeByte(c, i + 0x200, rom[i]);
+    return true;
+}
+
+bool chip8_patchProgram(Chip8* c, const uint8_t* oldRom, long oldLength, const uint8_t* newRom, long newLength) {
+    if (newLength < 0 || (0xFFF - 0x200) < newLength) {
+        printf("ERROR: ROM too large\n");
+        return false;
+    }
+
+    for(long i = 0; i < newLength; i++) {
+        if(i >= oldLength || oldRom[i] != newRom[i])
+            writeByte(c, i + 0x200, newRom[i]);
+    }
+    // whatever the old build had past the end of the new one is stale now
+    for(long i = newLength; i < oldLength; i++)
+        writeByte(c, i + 0x200, 0);
+    return true;
 }
 
 uint16_t fetch_opcode(Chip8* c) {
-    const uint8_t ms = c->memory[c->pc_reg];
-    const uint8_t ls = c->memory[c->pc_reg + 1];
+    const uint8_t ms = readByte(c, c->pc_reg);
+    const uint8_t ls = readByte(c, c->pc_reg + 1);
     c->pc_reg += 2;
     if(c->pc_reg > MEMORY_SIZE-1) c->pc_reg = MEMORY_SIZE-1;
     return (ms << 8) | ls;
@@ -227,14 +346,52 @@ uint8_t chip8_getPixel(Chip8* c,int x,int y) {
     return c->screen[y][x];
 }
 
-bool chip8_getBuzzer(Chip8* c) {
+uint16_t chip8_getProgramCounter(const Chip8* c) {
+    return c->pc_reg;
+}
+
+uint8_t chip8_getRegister(const Chip8* c, uint8_t index) {
+    return c->v_reg[index & (GENERAL_REG_SIZE-1)];
+}
+
+uint8_t chip8_getDelayTimer(const Chip8* c) {
+    return c->delay_timer;
+}
+
+uint8_t chip8_readMemory(const Chip8* c, uint16_t address) {
+    return readByte(c, address);
+}
+
+void chip8_setCallTracking(Chip8* c, bool enabled) {
+    c->track_calls = enabled;
+}
+
+uint8_t chip8_getCallStack(const Chip8* c, const uint16_t** entries) {
+    *entries = &c->call_stack[1];
+    return c->track_calls ? c->sp_reg : 0;
+}
+
+uint16_t chip8_getDrawnPixels(const Chip8* c) {
+    return c->drawn_pixels;
+}
+
+bool chip8_getBuzzer(const Chip8* c) {
     return c->sound_timer != 0;
 }
 
+uint32_t chip8_takeBuzzerEdges(Chip8* c, Chip8BuzzerEdge* edges, uint32_t capacity) {
+    const uint32_t taken = c->buzzer_edge_count < capacity ? c->buzzer_edge_count : capacity;
+    memcpy(edges, c->buzzer_edges, taken * sizeof(Chip8BuzzerEdge));
+    memmove(c->buzzer_edges, &c->buzzer_edges[taken], (c->buzzer_edge_count - taken) * sizeof(Chip8BuzzerEdge));
+    c->buzzer_edge_count -= (uint8_t)taken;
+    return taken;
+}
+
 void chip8_preformNextInstruction(Chip8* c) {
 
     const uint16_t opcode = fetch_opcode(c);
     if(DEBUG_PRINT) printf("at %x instruction %x: ",c->pc_reg-2,opcode);
+    c->drawn_pixels = 0;
 
     if(opcode == 0x00E0) { // 00E0 - CLS
         if( c->tickFromFixedUpdate == 0)
@@ -251,16 +408,17 @@ void chip8_preformNextInstruction(Chip8* c) {
     }
     else if(opcode == 0x00EE) { // 00EE - RET
         if(DEBUG_PRINT) printf("return");
-        assert(c->sp_reg > 0);
+        // the stack pointer wraps like the 4 bit one of the hardware, a return without a call doesn't leave the stack
         c->pc_reg = c->stack[c->sp_reg];
-        c->sp_reg--;
+        c->sp_reg = (c->sp_reg - 1) & (STACK_SIZE-1);
     }
     else if((opcode & 0xF000) == 0x0000) { //0nnn - SYS addr
         const uint16_t arg = (opcode & 0x0FFF);
-        printf("sys %i \n",arg);
-
-        for(int idx = 0; idx != GENERAL_REG_SIZE; idx++)
-            printf("debug: v_%x = %x \n",idx,c->v_reg[idx]);
+        if(DEBUG_PRINT) {
+            printf("sys %i \n",arg);
+            for(int idx = 0; idx != GENERAL_REG_SIZE; idx++)
+                printf("debug: v_%x = %x \n",idx,c->v_reg[idx]);
+        }
     }
     else if((opcode & 0xF000) == 0x1000) { //1nnn - JP addr
         const uint16_t arg = (opcode & 0x0FFF);
@@ -268,11 +426,11 @@ void chip8_preformNextInstruction(Chip8* c) {
         if(DEBUG_PRINT) printf("goto %x",arg);
     }
     else if((opcode & 0xF000) == 0x2000) { //2nnn - CALL addr
-        assert(c->sp_reg < STACK_SIZE-1);
         const uint16_t arg = (opcode & 0x0FFF);
 
-        c->sp_reg++;
+        c->sp_reg = (c->sp_reg + 1) & (STACK_SIZE-1);
         c->stack[c->sp_reg] = c->pc_reg;
+        if(c->track_calls) c->call_stack[c->sp_reg] = arg;
         c->pc_reg = arg;
         if(DEBUG_PRINT) printf("*(%x)()",arg);
     }
@@ -411,9 +569,10 @@ void chip8_preformNextInstruction(Chip8* c) {
             // Reset collision register to FALSE
             c->v_reg[0xF] = 0;
             for (int y_coordinate = 0; y_coordinate < sprite_height && (y_location+y_coordinate) < FRAMEBUFFER_Y ; y_coordinate++) {
-                pixel = c->memory[c->i_reg + y_coordinate];
+                pixel = readByte(c, c->i_reg + y_coordinate);
                 for (int x_coordinate = 0; x_coordinate < 8  && (x_location+x_coordinate) < FRAMEBUFFER_X ; x_coordinate++) {
                     if ( pixel & (0x80 >> x_coordinate) ) {
+                        c->drawn_pixels++;
                         if (c->screen[y_location + y_coordinate][x_location + x_coordinate] == 1) {
                             c->v_reg[0xF] = 1;
                         }
@@ -431,7 +590,7 @@ void chip8_preformNextInstruction(Chip8* c) {
     else if((opcode & 0xF0FF) == 0xE09E) { // Ex9E - SKP Vx
         const uint8_t selectedRegX = (opcode & 0x0F00) >> 2*4;
 
-        if(c->key[c->v_reg[selectedRegX]])
+        if(c->key[c->v_reg[selectedRegX] & (KEY_SIZE-1)])
             c->pc_reg += 2;
 
         if(DEBUG_PRINT) printf("if(pressedKey() == V_%x)",selectedRegX);
@@ -440,7 +599,7 @@ void chip8_preformNextInstruction(Chip8* c) {
     else if((opcode & 0xF0FF) == 0xE0A1) { // ExA1 - SKNP Vx
         const uint8_t selectedRegX = (opcode & 0x0F00) >> 2*4;
 
-        if(!c->key[c->v_reg[selectedRegX]])
+        if(!c->key[c->v_reg[selectedRegX] & (KEY_SIZE-1)])
             c->pc_reg += 2;
 
         if(DEBUG_PRINT) printf("if(pressedKey() != V_%x)",selectedRegX);
@@ -477,7 +636,10 @@ void chip8_preformNextInstruction(Chip8* c) {
 
     else if((opcode & 0xF0FF) == 0xF018) { //Fx18 - LD ST, Vx
         const uint8_t selectedRegX = (opcode & 0x0F00) >> 2*4;
+        const bool wasOn = c->sound_timer != 0;
         c->sound_timer = c->v_reg[selectedRegX];
+        if (wasOn != (c->sound_timer != 0))
+            recordBuzzerEdge(c, !wasOn);
 
         if(DEBUG_PRINT) printf("set_sound(V_%x)",selectedRegX);
     }
@@ -494,37 +656,82 @@ void chip8_preformNextInstruction(Chip8* c) {
     }
     else if((opcode & 0xF0FF) == 0xF033) { //Fx33 - LD B, Vx
         const uint8_t selectedRegX = (opcode & 0x0F00) >> 2*4;
-        c->memory[c->i_reg+0] = ((int)c->v_reg[selectedRegX] % 1000)/100;
-        c->memory[c->i_reg+1] = ((int)c->v_reg[selectedRegX] % 100)/10;
-        c->memory[c->i_reg+2] = (int)c->v_reg[selectedRegX] % 10;
+        writeByte(c, c->i_reg+0, ((int)c->v_reg[selectedRegX] % 1000)/100);
+        writeByte(c, c->i_reg+1, ((int)c->v_reg[selectedRegX] % 100)/10);
+        writeByte(c, c->i_reg+2, (int)c->v_reg[selectedRegX] % 10);
         if(DEBUG_PRINT) printf("*(I+0) = BCD(V_%x,100); *(I+1) = BCD(V_%x,10); *(I+2) = BCD(V_%x,1)",selectedRegX,selectedRegX,selectedRegX);
     }
     else if((opcode & 0xF0FF) == 0xF055) { //LD [I], Vx
         const uint8_t selectedRegX = (opcode & 0x0F00) >> 2*4;
         for(int idx=0;idx <= selectedRegX;idx++) {
-            c->memory[c->i_reg+idx] = c->v_reg[idx];
+            writeByte(c, c->i_reg+idx, c->v_reg[idx]);
         }
         if(DEBUG_PRINT) printf("reg_dump(V_0,V_%x,I)",selectedRegX);
     }
     else if((opcode & 0xF0FF) == 0xF065) { //LD Vx, [I]
         const uint8_t selectedRegX = (opcode & 0x0F00) >> 2*4;
         for(int idx=0;idx <= selectedRegX;idx++) {
-            c->v_reg[idx] = c->memory[c->i_reg+idx];
+            c->v_reg[idx] = readByte(c, c->i_reg+idx);
         }
         if(DEBUG_PRINT) printf("reg_load(V_0,V_%x,I)",selectedRegX);
     }
     else {
-        printf("unsuported instruction %d \n",opcode);
+        if(DEBUG_PRINT) printf("unsuported instruction %d \n",opcode);
     }
 
     if(DEBUG_PRINT) printf("\n");
     c->tickFromFixedUpdate++;
 }
 
+Chip8StopReason chip8_run(Chip8* c, uint32_t maxInstructions) {
+    for(uint32_t executed = 0; executed != maxInstructions; executed++) {
+        const uint16_t pc = c->pc_reg;
+        if (chip8_isBreakpoint(c, pc) && c->resume_address != pc) {
+            c->resume_address = pc;
+            return CHIP8_STOP_BREAKPOINT;
+        }
+        c->resume_address = -1;
+
+        const uint16_t opcode = (readByte(c, pc) << 8) | readByte(c, pc + 1);
+        chip8_preformNextInstruction(c);
+
+        // both rewind the program counter until something outside the program changes
+        if (c->pc_reg == pc && opcode == 0x00E0)
+            return CHIP8_STOP_FRAME_END;
+        if (c->pc_reg == pc && (opcode & 0xF0FF) == 0xF00A)
+            return CHIP8_STOP_WAITING_FOR_KEY;
+    }
+    return CHIP8_STOP_INSTRUCTION_LIMIT;
+}
+
+void chip8_setBreakpoint(Chip8* c, uint16_t address, bool enabled) {
+    address &= MEMORY_SIZE-1;
+    if (enabled)
+        c->breakpoints[address / 8] |= (uint8_t)(1 << (address % 8));
+    else
+        c->breakpoints[address / 8] &= (uint8_t)~(1 << (address % 8));
+}
+
+void chip8_clearBreakpoints(Chip8* c) {
+    for(int idx = 0; idx != MEMORY_SIZE / 8; idx++)
+        c->breakpoints[idx] = 0;
+}
+
+bool chip8_isBreakpoint(const Chip8* c, uint16_t address) {
+    address &= MEMORY_SIZE-1;
+    return c->breakpoints[address / 8] & (1 << (address % 8));
+}
+
 void chip8_fixedUpdate(Chip8* c) {
-    c->tickFromFixedUpdate = 0;
     if(c->delay_timer > 0) c->delay_timer -= 1;
-    if(c->sound_timer > 0) c->sound_timer -= 1;
+    if(c->sound_timer > 0 && --c->sound_timer == 0) recordBuzzerEdge(c, false);
+
+    // the frame is over, the edges it had can be placed within it now
+    for(int idx = 0; idx != c->buzzer_edge_count; idx++)
+        if (c->buzzer_edges[idx].frame == c->frame_count)
+            c->buzzer_edges[idx].frameInstructions = (uint32_t)c->tickFromFixedUpdate;
+    c->frame_count++;
+    c->tickFromFixedUpdate = 0;
 
     for(int idx = 0; idx != KEY_SIZE; idx++) {
         c->prev_key[idx] = c->key[idx];
@@ -532,5 +739,16 @@ void chip8_fixedUpdate(Chip8* c) {
 }
 
 void chip8_setKeyPressed(Chip8* c, uint8_t inKey, bool inStatus) {
+    if (inKey >= KEY_SIZE)
+        return;
     c->key[inKey] = inStatus;
 }
+
+void chip8_setKeys(Chip8* c, uint16_t pressedMask) {
+    for(int idx = 0; idx != KEY_SIZE; idx++)
+        c->key[idx] = (pressedMask >> idx) & 1;
+}
+
+Chip8Framebuffer chip8_getFramebuffer(const Chip8* c) {
+    return (Chip8Framebuffer){ &c->screen[0][0], FRAMEBUFFER_X, FRAMEBUFFER_Y, (int)sizeof(c->screen[0]), CHIP8_PIXEL_U32_ON_OFF };
+}
@@ -1,19 +1,114 @@
 #pragma once
+
+// chip8core: the interpreter, without window, audio or file formats beyond raw roms
+
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 struct Chip8;
 typedef struct Chip8 Chip8;
 
+// allocate returns an instance in its power-on state; initialize resets one to it, breakpoints and call tracking are kept
 Chip8* chip8_allocate();
 void chip8_initialize(Chip8*);
 void chip8_deallocate(Chip8*);
 
+struct Chip8Pool;
+typedef struct Chip8Pool Chip8Pool;
+
+// count instances in one block, each a copy of powerOnState (e.g. a chip8_allocate'd instance with a rom loaded),
+// which is kept as the template the resets copy from; for running many machines side by side. The memory of
+// powerOnState is copied once and shared, an instance only gets its own copy of a 256 byte page when writing to it
+Chip8Pool* chip8_allocatePool(size_t count, const Chip8* powerOnState);
+void chip8_deallocatePool(Chip8Pool*);
+size_t chip8_poolCount(const Chip8Pool*);
+Chip8* chip8_poolInstance(Chip8Pool*, size_t idx);
+// guest state back to the template, breakpoints and call tracking of the instance are kept
+void chip8_poolReset(Chip8Pool*, size_t idx);
+void chip8_poolResetAll(Chip8Pool*);
+
+struct Chip8State;
+typedef struct Chip8State Chip8State;
+
+// snapshots for run-ahead and rewinding: registers, timers, stack, keys, memory, screen and the buzzer edges not
+// taken yet; breakpoints and call tracking aren't part of them. A snapshot of a pool instance is valid while the pool is
+Chip8State* chip8_allocateState();
+void chip8_deallocateState(Chip8State*);
+void chip8_saveState(const Chip8*, Chip8State*);
+void chip8_loadState(Chip8*, const Chip8State*);
+
 void chip8_loadProgramFromPath(Chip8*,char*);
+// copies rom to 0x200, the path for embedders that already hold the program in memory
+bool chip8_loadProgramFromMemory(Chip8*,const uint8_t* rom,long length);
+// writes a rebuilt program over the running one, registers, timers, stack and screen are kept;
+// bytes equal in both builds keep their current value, so data written by the program survives
+bool chip8_patchProgram(Chip8*,const uint8_t* oldRom,long oldLength,const uint8_t* newRom,long newLength);
 void chip8_preformNextInstruction(Chip8*);
 
+typedef enum {
+    CHIP8_STOP_INSTRUCTION_LIMIT,   // maxInstructions were executed
+    CHIP8_STOP_FRAME_END,           // cls waits for the next chip8_fixedUpdate (vsync)
+    CHIP8_STOP_WAITING_FOR_KEY,     // Fx0A, no key was released since the last chip8_fixedUpdate
+    CHIP8_STOP_BREAKPOINT           // the program counter is at a breakpoint, its instruction is not executed yet
+} Chip8StopReason;
+
+// executes up to maxInstructions in one call; after a breakpoint stop, the next call resumes past it
+Chip8StopReason chip8_run(Chip8*, uint32_t maxInstructions);
+void chip8_setBreakpoint(Chip8*, uint16_t address, bool enabled);
+void chip8_clearBreakpoints(Chip8*);
+bool chip8_isBreakpoint(const Chip8*, uint16_t address);
+
 void chip8_fixedUpdate(Chip8*);
 
 void chip8_setKeyPressed(Chip8*, uint8_t, bool);
+// all 16 keys at once, bit n set while key n is down
+void chip8_setKeys(Chip8*, uint16_t pressedMask);
+
+typedef enum {
+    CHIP8_PIXEL_U32_ON_OFF          // one uint32_t per pixel, 0 off and 1 on
+} Chip8PixelFormat;
+
+// the screen as the core keeps it, valid as long as c is; rows are stride bytes apart
+typedef struct {
+    const void* pixels;
+    int width;
+    int height;
+    int stride;
+    Chip8PixelFormat format;
+} Chip8Framebuffer;
+
+Chip8Framebuffer chip8_getFramebuffer(const Chip8*);
 
 uint8_t chip8_getPixel(Chip8*,int x,int y);
-bool chip8_getBuzzer(Chip8*);
+uint16_t chip8_getProgramCounter(const Chip8*);
+uint8_t chip8_getRegister(const Chip8*, uint8_t index);
+uint8_t chip8_getDelayTimer(const Chip8*);
+uint8_t chip8_readMemory(const Chip8*, uint16_t address);
+
+// shadow call stack for profilers: while enabled, 2nnn records the routine it enters next to its return address;
+// returns the depth, entries[0] being the outermost routine, 0 while disabled
+void chip8_setCallTracking(Chip8*, bool);
+uint8_t chip8_getCallStack(const Chip8*, const uint16_t** entries);
+// pixels flipped by the last instruction, the work of a Dxyn
+uint16_t chip8_getDrawnPixels(const Chip8*);
+bool chip8_getBuzzer(const Chip8*);
+
+// a change of the buzzer (sound timer set or run out), in emulated time
+typedef struct {
+    uint64_t frame;                 // chip8_fixedUpdate calls before the edge
+    uint32_t instruction;           // instructions of that frame executed before it
+    uint32_t frameInstructions;     // instructions the frame had in total, set by the chip8_fixedUpdate ending it
+    bool on;
+} Chip8BuzzerEdge;
+
+// moves up to capacity edges, oldest first, out of the core; take them after chip8_fixedUpdate so their frames are complete
+uint32_t chip8_takeBuzzerEdges(Chip8*, Chip8BuzzerEdge* edges, uint32_t capacity);
+
+#ifdef __cplusplus
+}
+#endif
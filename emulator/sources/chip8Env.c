@@ -0,0 +1,272 @@
+#include "chip8Env.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+typedef enum {
+    JOB_STEP,
+    JOB_RESET,
+    JOB_QUIT
+} Job;
+
+struct Chip8Env;
+
+typedef struct {
+    struct Chip8Env* env;
+    uint32_t part;
+    thrd_t thread;
+} Worker;
+
+struct Chip8Env {
+    Chip8Pool* pool;
+    uint32_t count;
+    uint32_t frameRepeat;
+    uint32_t instructionsPerFrame;
+    uint32_t maxEpisodeFrames;
+
+    Chip8EnvProbe* probes;
+    uint32_t probeCount;
+    uint8_t* probeValues;       // per environment, probeCount values as of the end of its last step or reset
+    uint32_t* episodeFrames;
+
+    // the calling thread runs part 0 of every job, worker n part n; parts are contiguous runs of environments,
+    // so neighbouring instances in the pool are stepped by the same thread
+    uint32_t partCount;
+    Worker* workers;
+
+    // the job in flight, published under lock by bumping generation
+    mtx_t lock;
+    cnd_t jobReady;
+    cnd_t jobDone;
+    uint64_t generation;
+    uint32_t pending;
+    Job job;
+    uint32_t jobCount;
+    const uint32_t* envIds;
+    const uint16_t* actions;
+    uint8_t* observations;
+    float* rewards;
+    bool* done;
+};
+
+static uint32_t cpuCount(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors;
+#else
+    const long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (uint32_t)count : 1;
+#endif
+}
+
+static uint8_t probeValue(const Chip8* c, const Chip8EnvProbe* probe) {
+    if (probe->source == CHIP8ENV_PROBE_REGISTER)
+        return chip8_getRegister(c, (uint8_t)probe->index);
+    return chip8_readMemory(c, probe->index);
+}
+
+static void packObservation(const Chip8* c, uint8_t* out) {
+    const Chip8Framebuffer screen = chip8_getFramebuffer(c);
+    for(int y = 0; y != screen.height; y++) {
+        const uint32_t* row = (const uint32_t*)((const uint8_t*)screen.pixels + y * screen.stride);
+        for(int x = 0; x != screen.width; x += 8) {
+            uint8_t bits = 0;
+            for(int bit = 0; bit != 8; bit++)
+                bits = (uint8_t)(bits << 1 | (row[x + bit] != 0));
+            *out++ = bits;
+        }
+    }
+}
+
+static void resetOne(Chip8Env* env, uint32_t envId, uint8_t* observation) {
+    chip8_poolReset(env->pool, envId);
+    const Chip8* c = chip8_poolInstance(env->pool, envId);
+    env->episodeFrames[envId] = 0;
+    for(uint32_t idx = 0; idx != env->probeCount; idx++)
+        env->probeValues[envId * env->probeCount + idx] = probeValue(c, &env->probes[idx]);
+    if (observation)
+        packObservation(c, observation);
+}
+
+static void stepOne(Chip8Env* env, uint32_t envId) {
+    Chip8* c = chip8_poolInstance(env->pool, envId);
+    chip8_setKeys(c, env->actions[envId]);
+    for(uint32_t frame = 0; frame != env->frameRepeat; frame++) {
+        // cls and Fx0A end the frame early, nothing changes before the next chip8_fixedUpdate
+        chip8_run(c, env->instructionsPerFrame);
+        chip8_fixedUpdate(c);
+    }
+    env->episodeFrames[envId] += env->frameRepeat;
+
+    float reward = 0.0f;
+    bool done = env->maxEpisodeFrames != 0 && env->episodeFrames[envId] >= env->maxEpisodeFrames;
+    uint8_t* previous = &env->probeValues[envId * env->probeCount];
+    for(uint32_t idx = 0; idx != env->probeCount; idx++) {
+        const Chip8EnvProbe* probe = &env->probes[idx];
+        const uint8_t value = probeValue(c, probe);
+        reward += probe->rewardScale * (float)((int)value - (int)previous[idx]);
+        done |= probe->endsEpisode && value == probe->doneValue;
+        previous[idx] = value;
+    }
+
+    if (env->observations)
+        packObservation(c, &env->observations[envId * CHIP8ENV_OBSERVATION_BYTES]);
+    if (env->rewards)
+        env->rewards[envId] = reward;
+    if (env->done)
+        env->done[envId] = done;
+}
+
+static void runPart(Chip8Env* env, uint32_t part) {
+    const uint32_t begin = (uint32_t)((uint64_t)env->jobCount * part / env->partCount);
+    const uint32_t end = (uint32_t)((uint64_t)env->jobCount * (part + 1) / env->partCount);
+    for(uint32_t idx = begin; idx != end; idx++) {
+        if (env->job == JOB_STEP)
+            stepOne(env, idx);
+        else if (env->envIds[idx] < env->count)
+            resetOne(env, env->envIds[idx], env->observations ? &env->observations[idx * CHIP8ENV_OBSERVATION_BYTES] : NULL);
+    }
+}
+
+static int workerMain(void* arg) {
+    Worker* worker = arg;
+    Chip8Env* env = worker->env;
+    uint64_t seen = 0;
+
+    mtx_lock(&env->lock);
+    for(;;) {
+        while (env->generation == seen)
+            cnd_wait(&env->jobReady, &env->lock);
+        seen = env->generation;
+        if (env->job == JOB_QUIT)
+            break;
+        mtx_unlock(&env->lock);
+
+        runPart(env, worker->part);
+
+        mtx_lock(&env->lock);
+        if (--env->pending == 0)
+            cnd_signal(&env->jobDone);
+    }
+    mtx_unlock(&env->lock);
+    return 0;
+}
+
+// hands the job described in env to the workers, runs part 0 and waits for the rest
+static void dispatch(Chip8Env* env, Job job) {
+    mtx_lock(&env->lock);
+    env->job = job;
+    env->pending = env->partCount - 1;
+    env->generation++;
+    cnd_broadcast(&env->jobReady);
+    mtx_unlock(&env->lock);
+
+    if (job == JOB_QUIT)
+        return;
+    runPart(env, 0);
+
+    mtx_lock(&env->lock);
+    while (env->pending != 0)
+        cnd_wait(&env->jobDone, &env->lock);
+    mtx_unlock(&env->lock);
+}
+
+Chip8Env* chip8Env_create(const Chip8EnvConfig* config) {
+    if (config->envCount == 0)
+        return NULL;
+
+    Chip8* powerOn = chip8_allocate();
+    if (!chip8_loadProgramFromMemory(powerOn, config->rom, config->romLength)) {
+        chip8_deallocate(powerOn);
+        return NULL;
+    }
+
+    Chip8Env* env = calloc(1, sizeof(Chip8Env));
+    env->pool = chip8_allocatePool(config->envCount, powerOn);
+    chip8_deallocate(powerOn);
+
+    env->count = config->envCount;
+    env->frameRepeat = config->frameRepeat != 0 ? config->frameRepeat : 1;
+    env->instructionsPerFrame = config->instructionsPerFrame;
+    env->maxEpisodeFrames = config->maxEpisodeFrames;
+
+    env->probeCount = config->probeCount;
+    env->probes = malloc((config->probeCount + 1) * sizeof(Chip8EnvProbe));
+    if (config->probeCount != 0)
+        memcpy(env->probes, config->probes, config->probeCount * sizeof(Chip8EnvProbe));
+    env->probeValues = calloc((size_t)config->envCount * config->probeCount + 1, sizeof(uint8_t));
+    env->episodeFrames = calloc(config->envCount, sizeof(uint32_t));
+
+    env->partCount = config->threadCount != 0 ? config->threadCount : cpuCount();
+    if (env->partCount > env->count)
+        env->partCount = env->count;
+    env->workers = calloc(env->partCount, sizeof(Worker));
+
+    mtx_init(&env->lock, mtx_plain);
+    cnd_init(&env->jobReady);
+    cnd_init(&env->jobDone);
+    for(uint32_t part = 1; part != env->partCount; part++) {
+        env->workers[part].env = env;
+        env->workers[part].part = part;
+        if (thrd_create(&env->workers[part].thread, workerMain, &env->workers[part]) != thrd_success) {
+            env->partCount = part;  // only the ones started are stopped again
+            chip8Env_destroy(env);
+            return NULL;
+        }
+    }
+
+    // every environment starts from power-on
+    for(uint32_t envId = 0; envId != env->count; envId++)
+        resetOne(env, envId, NULL);
+    return env;
+}
+
+void chip8Env_destroy(Chip8Env* env) {
+    if (env == NULL)
+        return;
+
+    dispatch(env, JOB_QUIT);
+    for(uint32_t part = 1; part != env->partCount; part++)
+        thrd_join(env->workers[part].thread, NULL);
+    cnd_destroy(&env->jobDone);
+    cnd_destroy(&env->jobReady);
+    mtx_destroy(&env->lock);
+
+    chip8_deallocatePool(env->pool);
+    free(env->workers);
+    free(env->episodeFrames);
+    free(env->probeValues);
+    free(env->probes);
+    free(env);
+}
+
+uint32_t chip8Env_count(const Chip8Env* env) {
+    return env->count;
+}
+
+void chip8Env_reset(Chip8Env* env, const uint32_t* envIds, uint32_t count, uint8_t* observations) {
+    env->jobCount = count;
+    env->envIds = envIds;
+    env->observations = observations;
+    dispatch(env, JOB_RESET);
+}
+
+void chip8Env_step(Chip8Env* env, const uint16_t* actions, uint8_t* observations, float* rewards, bool* done) {
+    env->jobCount = env->count;
+    env->actions = actions;
+    env->observations = observations;
+    env->rewards = rewards;
+    env->done = done;
+    dispatch(env, JOB_STEP);
+}
+
+Chip8* chip8Env_instance(Chip8Env* env, uint32_t envId) {
+    return chip8_poolInstance(env->pool, envId);
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include "chip8.h"
+
+// batch of emulators running one rom for training agents: every step applies one action per environment,
+// runs them on worker threads and returns their screens, rewards and episode ends; nothing is allocated per step
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct Chip8Env;
+typedef struct Chip8Env Chip8Env;
+
+// one observation is the 64x32 screen, 1 bit per pixel, rows of 8 bytes top to bottom, leftmost pixel in the high bit
+#define CHIP8ENV_OBSERVATION_BYTES (64 * 32 / 8)
+
+typedef enum {
+    CHIP8ENV_PROBE_REGISTER,        // index is a register, 0 to 15
+    CHIP8ENV_PROBE_MEMORY           // index is an address
+} Chip8EnvProbeSource;
+
+// a byte of guest state the environment watches, usually where the game keeps its score or lives
+typedef struct {
+    Chip8EnvProbeSource source;
+    uint16_t index;
+    float rewardScale;              // reward += rewardScale * (value after the step - value before it)
+    bool endsEpisode;               // done once the byte equals doneValue
+    uint8_t doneValue;
+} Chip8EnvProbe;
+
+typedef struct {
+    const uint8_t* rom;
+    long romLength;
+    uint32_t envCount;
+    uint32_t threadCount;           // 0 for one per cpu, 1 runs everything on the calling thread
+    uint32_t frameRepeat;           // frames emulated per action, at least 1
+    uint32_t instructionsPerFrame;  // a frame also ends early at cls or while waiting for a key
+    uint32_t maxEpisodeFrames;      // done after this many frames, 0 for no limit
+    const Chip8EnvProbe* probes;    // copied, may be freed after chip8Env_create
+    uint32_t probeCount;
+} Chip8EnvConfig;
+
+// NULL when the rom doesn't fit or the threads can't be started
+Chip8Env* chip8Env_create(const Chip8EnvConfig*);
+void chip8Env_destroy(Chip8Env*);
+uint32_t chip8Env_count(const Chip8Env*);
+
+// envIds back to power-on, ids past the last environment are ignored; observations receives count observations,
+// in the order of envIds (may be NULL)
+void chip8Env_reset(Chip8Env*, const uint32_t* envIds, uint32_t count, uint8_t* observations);
+// actions[n] is the key mask (bit k set while key k is down) environment n holds for the whole step;
+// every output has one entry per environment. An environment that is done keeps running until it is reset
+void chip8Env_step(Chip8Env*, const uint16_t* actions, uint8_t* observations, float* rewards, bool* done);
+
+// the emulator behind environment n, for inspection between steps
+Chip8* chip8Env_instance(Chip8Env*, uint32_t envId);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,172 @@
+#include "fpgaTiming.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define ADDRESS_SPACE 4096
+#define MAX_PRINTED_OVERRUNS 10
+
+// both cores run the same state machine (fpga_*/entry.vhd), only their clock differs;
+// a state executes in one cycle and is left one cycle later, or MEMORY_READ_DELAY cycles later
+// when it started a ram read, so every state costs 1 + max(delay, 1)
+#define MEMORY_READ_DELAY 10
+#define STATE 2
+#define READ_STATE (1 + MEMORY_READ_DELAY)
+#define FETCH (READ_STATE + READ_STATE + STATE + STATE)  // Fetch_Begin, StoreFirstByte, StoreSecondByte, ParseAndInitOpcode
+#define CLS (32 + STATE)                                 // Cls loops on itself over the 32 vram rows, then leaves
+#define DRAW_ROW (READ_STATE + STATE + STATE)            // Draw_ReadLine, Draw_WriteLine, Draw_Increment
+
+struct FpgaTiming {
+    const char* board;
+    uint32_t clockHz;
+    uint64_t cyclesPerFrame;
+
+    // frame in progress; idle cycles are spent polling the delay timer (or waiting for a key) and only count for throttling
+    uint64_t frameCycles;
+    uint64_t busyCycles;
+    bool idle;
+    int polledDelay;
+    uint16_t lastAddress;
+
+    uint64_t frames;
+    uint64_t totalBusyCycles;
+    uint64_t peakBusyCycles;
+    uint64_t peakFrame;
+    uint64_t overruns;
+
+    bool hangReported[ADDRESS_SPACE];
+};
+
+FpgaTiming* fpgaTiming_allocate(const char* board) {
+    uint32_t clockHz;
+    if (strcmp(board, "altera") == 0)
+        clockHz = 50000000;
+    else if (strcmp(board, "tangnano") == 0)
+        clockHz = 27000000;
+    else if ((clockHz = (uint32_t)strtoul(board, NULL, 10)) < 60)
+        return NULL;
+
+    FpgaTiming* t = calloc(1, sizeof(FpgaTiming));
+    t->board = board;
+    t->clockHz = clockHz;
+    t->cyclesPerFrame = clockHz / 60;
+    t->polledDelay = -1;
+    t->lastAddress = 0xFFFF;
+    return t;
+}
+
+void fpgaTiming_deallocate(FpgaTiming* t) {
+    free(t);
+}
+
+// opcodes the ParseAndInitOpcode state has no branch for leave it looping on itself, the core stops there
+static bool hangsCore(uint16_t opcode) {
+    switch (opcode & 0xF000) {
+        case 0xB000: return true;
+        case 0xE000: return (opcode & 0x00FF) != 0x9E && (opcode & 0x00FF) != 0xA1;
+        case 0xF000:
+            switch (opcode & 0x00FF) {
+                case 0x07: case 0x15: case 0x65: case 0x55: case 0x33: case 0x1E: case 0x29: case 0x0A: return false;
+                default: return true;
+            }
+        default: return false;
+    }
+}
+
+static uint32_t cyclesOf(uint16_t opcode, const Chip8* c) {
+    const uint8_t x = (opcode & 0x0F00) >> 8;
+    const uint8_t y = (opcode & 0x00F0) >> 4;
+
+    if (opcode == 0x00E0) return FETCH + CLS;
+    if (opcode == 0x00EE) return FETCH + STATE;               // Return
+    switch (opcode & 0xF000) {
+        case 0x2000: return FETCH + STATE;                    // Call
+        case 0xD000: {
+            // at least one row, rows past the bottom of the screen are clipped
+            const int rowsLeft = 32 - chip8_getRegister(c, y) % 32;
+            int rows = opcode & 0x000F;
+            if (rows == 0) rows = 1;
+            if (rows > rowsLeft) rows = rowsLeft;
+            return FETCH + rows * DRAW_ROW;
+        }
+        case 0xF000:
+            switch (opcode & 0x00FF) {
+                case 0x65: return FETCH + (x + 1) * (READ_STATE + STATE);   // LoadReg_PrepareAddress, LoadReg_Store
+                case 0x55: return FETCH + (x + 1) * (STATE + STATE);        // SaveReg_PrepareAddress, SaveReg_Store
+                case 0x33: return FETCH + STATE + STATE;                    // BCD1, BCD2
+            }
+            break;
+    }
+    return FETCH;
+}
+
+void fpgaTiming_charge(FpgaTiming* t, const Chip8* c) {
+    const uint16_t pc = chip8_getProgramCounter(c);
+    const uint16_t opcode = (uint16_t)(chip8_readMemory(c, pc) << 8 | chip8_readMemory(c, pc + 1));
+    const bool repeated = pc == t->lastAddress;
+    t->lastAddress = pc;
+
+    // the emulator holds cls until the next frame (vsync), the core doesn't, so its retries are free
+    if (opcode == 0x00E0 && repeated)
+        return;
+
+    if (hangsCore(opcode) && !t->hangReported[pc & (ADDRESS_SPACE - 1)]) {
+        t->hangReported[pc & (ADDRESS_SPACE - 1)] = true;
+        printf("fpga: opcode %04x at 0x%03x isn't implemented by the core, the board stops there\n", opcode, pc);
+    }
+
+    // reading the same running delay timer twice means the program is waiting for it
+    if ((opcode & 0xF0FF) == 0xF007) {
+        const uint8_t delay = chip8_getDelayTimer(c);
+        if (delay != 0 && delay == t->polledDelay)
+            t->idle = true;
+        t->polledDelay = delay;
+    }
+    if ((opcode & 0xF0FF) == 0xF00A)
+        t->idle = true;
+
+    const uint32_t cycles = cyclesOf(opcode, c);
+    t->frameCycles += cycles;
+    if (!t->idle)
+        t->busyCycles += cycles;
+}
+
+bool fpgaTiming_frameSpent(const FpgaTiming* t) {
+    return t->frameCycles >= t->cyclesPerFrame;
+}
+
+void fpgaTiming_endFrame(FpgaTiming* t, FILE* out) {
+    t->frames++;
+    t->totalBusyCycles += t->busyCycles;
+    if (t->busyCycles > t->peakBusyCycles) {
+        t->peakBusyCycles = t->busyCycles;
+        t->peakFrame = t->frames;
+    }
+    if (t->busyCycles > t->cyclesPerFrame) {
+        t->overruns++;
+        if (t->overruns <= MAX_PRINTED_OVERRUNS)
+            fprintf(out, "fpga: frame %llu needs %llu cycles, %.0f%% of the %llu the %s board has%s\n",
+                    (unsigned long long)t->frames, (unsigned long long)t->busyCycles, 100.0 * (double)t->busyCycles / (double)t->cyclesPerFrame,
+                    (unsigned long long)t->cyclesPerFrame, t->board, t->overruns == MAX_PRINTED_OVERRUNS ? ", further overruns are only counted" : "");
+    }
+
+    t->frameCycles = 0;
+    t->busyCycles = 0;
+    t->idle = false;
+    t->polledDelay = -1;
+    t->lastAddress = 0xFFFF;
+}
+
+void fpgaTiming_report(const FpgaTiming* t, FILE* out) {
+    if (t->frames == 0)
+        return;
+
+    const double budget = (double)t->cyclesPerFrame;
+    const double average = (double)t->totalBusyCycles / (double)t->frames;
+    fprintf(out, "fpga timing (%s, %u Hz, %llu cycles per frame): %llu frames\n",
+            t->board, t->clockHz, (unsigned long long)t->cyclesPerFrame, (unsigned long long)t->frames);
+    fprintf(out, "  average  %10.0f cycles  %6.2f%%\n", average, 100.0 * average / budget);
+    fprintf(out, "  peak     %10llu cycles  %6.2f%%  (frame %llu)\n",
+            (unsigned long long)t->peakBusyCycles, 100.0 * (double)t->peakBusyCycles / budget, (unsigned long long)t->peakFrame);
+    fprintf(out, "  overruns %10llu\n", (unsigned long long)t->overruns);
+}
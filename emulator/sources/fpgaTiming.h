@@ -0,0 +1,23 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "chip8.h"
+
+// clock cycles the FPGA cores (fpga_altera, fpga_tangNano) spend per opcode, summed per 1/60 s frame
+
+struct FpgaTiming;
+typedef struct FpgaTiming FpgaTiming;
+
+// "altera" (50 MHz), "tangnano" (27 MHz) or a clock in Hz, NULL when not recognised
+FpgaTiming* fpgaTiming_allocate(const char* board);
+void fpgaTiming_deallocate(FpgaTiming*);
+
+// call before every instruction, charges the one at the program counter
+void fpgaTiming_charge(FpgaTiming*, const Chip8* c);
+// true once this frame used up the cycles the board has in 1/60 s, the emulator should then stop until the next one
+bool fpgaTiming_frameSpent(const FpgaTiming*);
+// call on every chip8_fixedUpdate, closes the frame and reports an overrun
+void fpgaTiming_endFrame(FpgaTiming*, FILE* out);
+
+void fpgaTiming_report(const FpgaTiming*, FILE* out);
@@ -0,0 +1,220 @@
+#include "hotReload.h"
+
+#include "chip8asm.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+struct HotReload {
+    char* sourcePath;
+    char* sourceName;           // file name part of sourcePath, for messages
+    Chip8AsmResult* current;    // build running in the emulator
+    SourceMap* sourceMap;       // of current
+
+    int watchFd;                // inotify on the source directory, -1 when polling the modification time
+    time_t lastModified;
+};
+
+static char* readText(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (file == NULL)
+        return NULL;
+
+    fseek(file, 0, SEEK_END);
+    const long length = ftell(file);
+    rewind(file);
+
+    char* text = malloc(length + 1);
+    if (text != NULL) {
+        const size_t read = fread(text, 1, length, file);
+        text[read] = '\0';
+    }
+    fclose(file);
+    return text;
+}
+
+static char* readModule(const char* path, void* user) {
+    (void)user;
+    return readText(path);
+}
+
+static SourceMap* sourceMapOf(const Chip8AsmResult* result) {
+    size_t size;
+    const uint8_t* data = chip8asm_sourceMap(result, &size);
+    return sourceMap_loadFromMemory(data, size);
+}
+
+static time_t modificationTime(const char* path) {
+    struct stat info;
+    return stat(path, &info) == 0 ? info.st_mtime : 0;
+}
+
+static Chip8AsmResult* build(const char* sourcePath) {
+    char* source = readText(sourcePath);
+    if (source == NULL) {
+        printf("hot reload: couldn't open %s\n", sourcePath);
+        return NULL;
+    }
+
+    Chip8AsmResult* result = chip8asm_assemble(source, strlen(source), sourcePath, readModule, NULL);
+    free(source);
+
+    if (!chip8asm_succeeded(result)) {
+        for(size_t idx = 0; idx != chip8asm_diagnosticCount(result); idx++)
+            printf("%s\n", chip8asm_diagnostic(result, idx));
+        chip8asm_free(result);
+        return NULL;
+    }
+    return result;
+}
+
+// code can only be patched under a running program when every label kept its address,
+// otherwise return addresses on the stack and pointers in registers would point into the wrong code
+static bool sameLayout(const Chip8AsmResult* a, const Chip8AsmResult* b) {
+    const size_t count = chip8asm_symbolCount(a);
+    if (count != chip8asm_symbolCount(b))
+        return false;
+
+    for(size_t idx = 0; idx != count; idx++) {
+        if (chip8asm_symbolAddress(a, idx) != chip8asm_symbolAddress(b, idx)
+            || strcmp(chip8asm_symbolName(a, idx), chip8asm_symbolName(b, idx)) != 0)
+            return false;
+    }
+    return true;
+}
+
+static bool sourceChanged(HotReload* h) {
+#ifdef __linux__
+    if (h->watchFd != -1) {
+        // editors often save through a temporary file and a rename, so the whole directory is watched
+        char events[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+        bool changed = false;
+        ssize_t length;
+        while ((length = read(h->watchFd, events, sizeof(events))) > 0) {
+            for(char* it = events; it < events + length; it += sizeof(struct inotify_event) + ((struct inotify_event*)it)->len) {
+                const struct inotify_event* event = (const struct inotify_event*)it;
+                const size_t nameLength = event->len ? strlen(event->name) : 0;
+                if (nameLength >= 6 && strcmp(event->name + nameLength - 6, ".c8asm") == 0)
+                    changed = true;
+            }
+        }
+        return changed;
+    }
+#endif
+    const time_t modified = modificationTime(h->sourcePath);
+    if (modified == h->lastModified)
+        return false;
+    h->lastModified = modified;
+    return true;
+}
+
+HotReload* hotReload_create(Chip8* c, const char* sourcePath) {
+    Chip8AsmResult* result = build(sourcePath);
+    if (result == NULL)
+        return NULL;
+
+    size_t length;
+    const uint8_t* rom = chip8asm_bytes(result, &length);
+    if (!chip8_loadProgramFromMemory(c, rom, (long)length)) {
+        chip8asm_free(result);
+        return NULL;
+    }
+
+    HotReload* h = malloc(sizeof(HotReload));
+    h->sourcePath = malloc(strlen(sourcePath) + 1);
+    strcpy(h->sourcePath, sourcePath);
+    h->current = result;
+    h->sourceMap = sourceMapOf(result);
+    h->lastModified = modificationTime(sourcePath);
+    h->watchFd = -1;
+
+    char* separator = strrchr(h->sourcePath, '/');
+    h->sourceName = separator ? separator + 1 : h->sourcePath;
+
+#ifdef __linux__
+    h->watchFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (h->watchFd != -1) {
+        char* directory = malloc(strlen(sourcePath) + 2);
+        if (separator) {
+            const size_t directoryLength = separator - h->sourcePath;
+            memcpy(directory, h->sourcePath, directoryLength);
+            directory[directoryLength] = '\0';
+            if (directoryLength == 0) strcpy(directory, "/");
+        }
+        else {
+            strcpy(directory, ".");
+        }
+
+        if (inotify_add_watch(h->watchFd, directory, IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) == -1) {
+            close(h->watchFd);
+            h->watchFd = -1;
+        }
+        free(directory);
+    }
+#endif
+
+    printf("hot reload: watching %s\n", h->sourcePath);
+    return h;
+}
+
+void hotReload_destroy(HotReload* h) {
+    if (h == NULL)
+        return;
+#ifdef __linux__
+    if (h->watchFd != -1)
+        close(h->watchFd);
+#endif
+    chip8asm_free(h->current);
+    sourceMap_deallocate(h->sourceMap);
+    free(h->sourcePath);
+    free(h);
+}
+
+void hotReload_update(HotReload* h, Chip8* c) {
+    if (!sourceChanged(h))
+        return;
+
+    Chip8AsmResult* result = build(h->sourcePath);
+    if (result == NULL) {
+        printf("hot reload: %s has errors, keeping the running program\n", h->sourceName);
+        return;
+    }
+
+    size_t oldLength, newLength;
+    const uint8_t* oldRom = chip8asm_bytes(h->current, &oldLength);
+    const uint8_t* newRom = chip8asm_bytes(result, &newLength);
+
+    if (sameLayout(h->current, result)) {
+        if (!chip8_patchProgram(c, oldRom, (long)oldLength, newRom, (long)newLength)) {
+            chip8asm_free(result);
+            return;
+        }
+        printf("hot reload: patched %s\n", h->sourceName);
+    }
+    else {
+        chip8_initialize(c);
+        if (!chip8_loadProgramFromMemory(c, newRom, (long)newLength)) {
+            chip8_loadProgramFromMemory(c, oldRom, (long)oldLength);
+            chip8asm_free(result);
+            return;
+        }
+        printf("hot reload: labels moved, %s restarted\n", h->sourceName);
+    }
+
+    chip8asm_free(h->current);
+    h->current = result;
+    sourceMap_deallocate(h->sourceMap);
+    h->sourceMap = sourceMapOf(result);
+}
+
+const SourceMap* hotReload_sourceMap(const HotReload* h) {
+    return h->sourceMap;
+}
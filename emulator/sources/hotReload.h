@@ -0,0 +1,17 @@
+#pragma once
+#include "chip8.h"
+#include "sourceMap.h"
+
+struct HotReload;
+typedef struct HotReload HotReload;
+
+// assembles the .c8asm source into c and starts watching it, NULL when the first build fails
+HotReload* hotReload_create(Chip8* c, const char* sourcePath);
+void hotReload_destroy(HotReload*);
+
+// call once per frame; after the source (or a module next to it) changed, re-assembles it in-process
+// and patches c in place, or resets c when labels moved; a failed build keeps the running program
+void hotReload_update(HotReload*, Chip8* c);
+
+// source map of the running build, replaced on every reload
+const SourceMap* hotReload_sourceMap(const HotReload*);
@@ -2,43 +2,102 @@
 
 #include "raylib.h"
 #include "chip8.h"
+#include "hotReload.h"
+#include "sourceMap.h"
+#include "profiler.h"
+#include "fpgaTiming.h"
+#include "buzzer.h"
+#include "recorder.h"
+#include <signal.h>
 #include <time.h>
 #include <math.h>
 #include <malloc.h>
+#include <stdlib.h>
+#include <string.h>
 
 #define SCREEN_X 64
 #define SCREEN_Y 32
 
-#define MAX_SAMPLES 512
-#define MAX_SAMPLES_PER_UPDATE  4096
+#define AUDIO_BUFFER_SAMPLES 512    // ~12 ms at 44.1 kHz
 #define SAMPLE_RATE  44100
+#define BUZZER_FREQUENCY 440.0f
 
-float frequency = 440.0f;
-float sineIdx = 0.0f;
+// the raylib stream callback has no user pointer
+Buzzer* buzzer = NULL;
 
-bool audioEnabled = false;
+#define MAX_BREAKPOINTS 32
+#define INSTRUCTIONS_PER_RUN 1024
+#define MAX_RUN_AHEAD 8
+#define RUN_AHEAD_INSTRUCTIONS 65536    // per frame, for programs that never wait for the next one
 
-void AudioInputCallback(void *buffer, unsigned int frames)
+// chip8 keypad on the left of a qwerty keyboard, indexed by chip8 key:  1 2 3 C / 4 5 6 D / 7 8 9 E / A 0 B F
+const int keyMap[16] = {
+    KEY_X, KEY_ONE, KEY_TWO, KEY_THREE,
+    KEY_Q, KEY_W, KEY_E, KEY_A,
+    KEY_S, KEY_D, KEY_Z, KEY_C,
+    KEY_FOUR, KEY_R, KEY_F, KEY_V
+};
+
+// what the crash report needs when the process faults inside the core
+const SourceMap* crashSourceMap = NULL;
+const Chip8* crashCore = NULL;
+
+void CrashHandler(int signalNumber)
 {
-    float incr = frequency/(float)SAMPLE_RATE;
-    short *d = (short *)buffer;
+    // the process is going down anyway, so plain stdio is good enough here;
+    // the core fetched the crashing instruction already, so it is the one before the program counter
+    char location[256];
+    sourceMap_describe(crashSourceMap, (uint16_t)(chip8_getProgramCounter(crashCore) - 2), location, sizeof(location));
+    fprintf(stderr, "crash (signal %d) at %s\n", signalNumber, location);
+    signal(signalNumber, SIG_DFL);
+    raise(signalNumber);
+}
 
-    for (unsigned int i = 0; i < frames; i++)
-    {
-        d[i] = (short)(8000.0f*sinf(2*PI*sineIdx));
+// emulates frames past the real one with the current input, stopping early at a breakpoint
+void RunAhead(Chip8* c, int frames) {
+    for(int frame = 0; frame != frames; frame++) {
+        if(chip8_run(c, RUN_AHEAD_INSTRUCTIONS) == CHIP8_STOP_BREAKPOINT)
+            return;
+        chip8_fixedUpdate(c);
+    }
+}
 
-        if(audioEnabled) {
-            sineIdx += incr;
-            if (sineIdx > 1.0f) sineIdx -= 1.0f;
+// breakpoints are kept as written ("label", "file:line" or "0x2a0") and resolved again whenever the source map changes
+int ResolveBreakpoints(Chip8* c, const SourceMap* map, char** specs, int specCount) {
+    chip8_clearBreakpoints(c);
+    int resolved = 0;
+    for(int idx = 0; idx != specCount; idx++) {
+        uint16_t address;
+        if(strncmp(specs[idx], "0x", 2) == 0)
+            address = (uint16_t)strtol(specs[idx], NULL, 16);
+        else if(!sourceMap_findAddress(map, specs[idx], &address)) {
+            printf("breakpoint %s: not found in the source map\n", specs[idx]);
+            continue;
         }
+        chip8_setBreakpoint(c, address, true);
+        resolved++;
     }
+    return resolved;
+}
+
+void PrintLocation(const char* what, const SourceMap* map, uint16_t address)
+{
+    char location[256];
+    sourceMap_describe(map, address, location, sizeof(location));
+    printf("%s at %s\n", what, location);
+}
+
+void AudioInputCallback(void *buffer, unsigned int frames)
+{
+    buzzer_render(buzzer, (int16_t*)buffer, frames);
 }
 
 int main(int argc, char * argv[])
 {
     srand(time(NULL));
+    buzzer = buzzer_allocate(SAMPLE_RATE, BUZZER_FREQUENCY);
     InitAudioDevice();
-    SetAudioStreamBufferSizeDefault(MAX_SAMPLES_PER_UPDATE);
+    SetAudioStreamBufferSizeDefault(AUDIO_BUFFER_SAMPLES);
     AudioStream stream = LoadAudioStream(SAMPLE_RATE, 16, 1);
     SetAudioStreamCallback(stream, AudioInputCallback);
     PlayAudioStream(stream);
@@ -46,10 +105,88 @@ int main(int argc, char * argv[])
     Chip8* c = chip8_allocate();
     chip8_initialize(c);
 
-    if(argc > 1)
-        chip8_loadProgramFromPath(c,argv[1]);
-    else
-        chip8_loadProgramFromPath(c,"./output.ch8");
+    // chip8Emu [program.ch8 | source.c8asm] [--break label|file:line|0x2a0]... [--profile] [--flame prefix]
+    //          [--fpga altera|tangnano|clockHz [--throttle]] [--runahead frames]
+    //          [--record capture.c8rec]
+    const char* programPath = "./output.ch8";
+    const char* flamePrefix = NULL;
+    FpgaTiming* fpgaTiming = NULL;
+    bool throttle = false;
+    int runAheadFrames = 0;
+    Recorder* recorder = NULL;
+    char* breakpointSpecs[MAX_BREAKPOINTS];
+    int breakpointSpecCount = 0;
+    Profiler* profiler = NULL;
+    for(int argIdx = 1; argIdx < argc; argIdx++) {
+        if(strcmp(argv[argIdx], "--break") == 0 && argIdx + 1 < argc) {
+            if(breakpointSpecCount != MAX_BREAKPOINTS)
+                breakpointSpecs[breakpointSpecCount++] = argv[argIdx + 1];
+            argIdx++;
+        }
+        else if(strcmp(argv[argIdx], "--profile") == 0 && profiler == NULL)
+            profiler = profiler_allocate();
+        else if(strcmp(argv[argIdx], "--flame") == 0 && argIdx + 1 < argc) {
+            // call paths are profiled on top of the flat profile
+            flamePrefix = argv[++argIdx];
+            if(profiler == NULL) profiler = profiler_allocate();
+            chip8_setCallTracking(c, true);
+        }
+        else if(strcmp(argv[argIdx], "--fpga") == 0 && argIdx + 1 < argc) {
+            fpgaTiming = fpgaTiming_allocate(argv[++argIdx]);
+            if(fpgaTiming == NULL) {
+                printf("--fpga expects altera, tangnano or a clock in Hz\n");
+                return EXIT_FAILURE;
+            }
+        }
+        else if(strcmp(argv[argIdx], "--throttle") == 0)
+            throttle = true;
+        else if(strcmp(argv[argIdx], "--record") == 0 && argIdx + 1 < argc) {
+            recorder = recorder_create(argv[++argIdx]);
+            if(recorder == NULL) {
+                printf("ERROR: can't create %s\n", argv[argIdx]);
+                return EXIT_FAILURE;
+            }
+        }
+        else if(strcmp(argv[argIdx], "--runahead") == 0 && argIdx + 1 < argc) {
+            runAheadFrames = atoi(argv[++argIdx]);
+            if(runAheadFrames < 0 || runAheadFrames > MAX_RUN_AHEAD) {
+                printf("--runahead expects 0 to %d frames\n", MAX_RUN_AHEAD);
+                return EXIT_FAILURE;
+            }
+        }
+        else
+            programPath = argv[argIdx];
+    }
+
+    // a .c8asm source is assembled in-process and reloaded whenever it is saved,
+    // a rom gets the source map chip8Asm wrote next to it
+    HotReload* hotReload = NULL;
+    SourceMap* romSourceMap = NULL;
+    const size_t programPathLength = strlen(programPath);
+    if(programPathLength > 6 && strcmp(programPath + programPathLength - 6, ".c8asm") == 0) {
+        hotReload = hotReload_create(c,programPath);
+        if(hotReload == NULL)
+            return EXIT_FAILURE;
+    }
+    else {
+        chip8_loadProgramFromPath(c,(char*)programPath);
+
+        char mapPath[4096];
+        const char* extension = strrchr(programPath, '.');
+        const size_t stemLength = extension && !strpbrk(extension, "/\\") ? (size_t)(extension - programPath) : programPathLength;
+        snprintf(mapPath, sizeof(mapPath), "%.*s.c8map", (int)stemLength, programPath);
+        romSourceMap = sourceMap_loadFromPath(mapPath);
+    }
+
+    const SourceMap* sourceMap = hotReload ? hotReload_sourceMap(hotReload) : romSourceMap;
+    ResolveBreakpoints(c, sourceMap, breakpointSpecs, breakpointSpecCount);
+    bool paused = false;
+    bool resumeFromBreak = false;
+
+    crashSourceMap = sourceMap;
+    crashCore = c;
+    signal(SIGABRT, CrashHandler);
+    signal(SIGSEGV, CrashHandler);
 
     const int screenWidth = SCREEN_X*8;
     const int screenHeight = SCREEN_Y*8;
@@ -57,53 +194,130 @@ int main(int argc, char * argv[])
     InitWindow(screenWidth, screenHeight, "chip8");
 
     SetTargetFPS(-1);
+    Chip8State* runAheadState = chip8_allocateState();
     double lastTime = (double)clock()/CLOCKS_PER_SEC;
     double lastDrawTime = lastTime;
 
     while (!WindowShouldClose())
     {
-        audioEnabled = chip8_getBuzzer(c);
-        chip8_setKeyPressed(c,0x1,IsKeyDown(KEY_ONE));
-        chip8_setKeyPressed(c,0x2,IsKeyDown(KEY_TWO));
-        chip8_setKeyPressed(c,0x3,IsKeyDown(KEY_THREE));
-        chip8_setKeyPressed(c,0xC,IsKeyDown(KEY_FOUR));
-
-        chip8_setKeyPressed(c,0x4,IsKeyDown(KEY_Q));
-        chip8_setKeyPressed(c,0x5,IsKeyDown(KEY_W));
-        chip8_setKeyPressed(c,0x6,IsKeyDown(KEY_E));
-        chip8_setKeyPressed(c,0xD,IsKeyDown(KEY_R));
-
-        chip8_setKeyPressed(c,0x7,IsKeyDown(KEY_A));
-        chip8_setKeyPressed(c,0x8,IsKeyDown(KEY_S));
-        chip8_setKeyPressed(c,0x9,IsKeyDown(KEY_D));
-        chip8_setKeyPressed(c,0xE,IsKeyDown(KEY_F));
-
-        chip8_setKeyPressed(c,0xA,IsKeyDown(KEY_Z));
-        chip8_setKeyPressed(c,0x0,IsKeyDown(KEY_X));
-        chip8_setKeyPressed(c,0xB,IsKeyDown(KEY_C));
-        chip8_setKeyPressed(c,0xF,IsKeyDown(KEY_V));
+        if(hotReload) {
+            hotReload_update(hotReload,c);
+            if(hotReload_sourceMap(hotReload) != sourceMap) {
+                sourceMap = hotReload_sourceMap(hotReload);
+                crashSourceMap = sourceMap;
+                ResolveBreakpoints(c, sourceMap, breakpointSpecs, breakpointSpecCount);
+            }
+        }
+
+        // F5 continues from a breakpoint, F10 executes a single instruction
+        if(paused && IsKeyPressed(KEY_F5)) {
+            paused = false;
+            resumeFromBreak = true;
+        }
+        if(paused && IsKeyPressed(KEY_F10)) {
+            if(profiler) profiler_sample(profiler, chip8_getProgramCounter(c));
+            if(fpgaTiming) fpgaTiming_charge(fpgaTiming, c);
+            chip8_preformNextInstruction(c);
+            if(flamePrefix) profiler_sampleCalls(profiler, c);
+            PrintLocation("step", sourceMap, chip8_getProgramCounter(c));
+        }
+
+        uint16_t pressedKeys = 0;
+        for(int key = 0; key != 16; key++)
+            if(IsKeyDown(keyMap[key]))
+                pressedKeys |= (uint16_t)(1 << key);
+        chip8_setKeys(c, pressedKeys);
+
+        // instrumented runs step one instruction at a time, so every instruction is sampled
+        const bool instrumented = profiler != NULL || fpgaTiming != NULL;
+        bool frameDone = false;
 
         lastTime  = (double)clock()/CLOCKS_PER_SEC;
         while(lastTime - lastDrawTime  < 1.0/60.0)
         {
             lastTime  = (double)clock()/CLOCKS_PER_SEC;
+            if(paused || frameDone)
+                continue;
+
+            if(!instrumented) {
+                const Chip8StopReason reason = chip8_run(c, INSTRUCTIONS_PER_RUN);
+                if(reason == CHIP8_STOP_BREAKPOINT) {
+                    paused = true;
+                    PrintLocation("break", sourceMap, chip8_getProgramCounter(c));
+                }
+                // nothing changes before the next chip8_fixedUpdate
+                frameDone = reason == CHIP8_STOP_FRAME_END || reason == CHIP8_STOP_WAITING_FOR_KEY;
+                continue;
+            }
+
+            const uint16_t pc = chip8_getProgramCounter(c);
+            if(chip8_isBreakpoint(c, pc) && !resumeFromBreak) {
+                paused = true;
+                PrintLocation("break", sourceMap, pc);
+                continue;
+            }
+            resumeFromBreak = false;
+
+            // at FPGA speed, a frame ends once the board would have run out of cycles
+            if(fpgaTiming && throttle && fpgaTiming_frameSpent(fpgaTiming))
+                continue;
+
+            if(profiler) profiler_sample(profiler, pc);
+            if(fpgaTiming) fpgaTiming_charge(fpgaTiming, c);
             chip8_preformNextInstruction(c);
+            if(flamePrefix) profiler_sampleCalls(profiler, c);
         }
 
         lastDrawTime = lastTime;
-        chip8_fixedUpdate(c);
+        if(!paused) {
+            chip8_fixedUpdate(c);
+            buzzer_takeEdges(buzzer, c);
+            if(recorder) recorder_captureFrame(recorder, c);
+            if(fpgaTiming) fpgaTiming_endFrame(fpgaTiming, stdout);
+        }
+
+        // run-ahead shows the frame the current input leads to runAheadFrames from now, then the real one is restored;
+        // instrumented runs see every instruction once, so they don't run ahead
+        const bool ranAhead = runAheadFrames != 0 && !paused && !instrumented;
+        if(ranAhead) {
+            chip8_saveState(c, runAheadState);
+            RunAhead(c, runAheadFrames);
+        }
 
         BeginDrawing();
         ClearBackground(BLACK);
-        for(int x = 0; x != SCREEN_X; x++)
-            for(int y = 0; y != SCREEN_Y; y++)
-                if(chip8_getPixel(c,x,y))
+        const Chip8Framebuffer screen = chip8_getFramebuffer(c);
+        for(int y = 0; y != screen.height; y++) {
+            const uint32_t* row = (const uint32_t*)((const uint8_t*)screen.pixels + y * screen.stride);
+            for(int x = 0; x != screen.width; x++)
+                if(row[x])
                     DrawRectangle(x*8,y*8,8,8,DARKGREEN);
+        }
         EndDrawing();
+
+        if(ranAhead)
+            chip8_loadState(c, runAheadState);
+    }
+
+    if(profiler) {
+        if(flamePrefix) profiler_writeFolded(profiler, sourceMap, flamePrefix);
+        profiler_report(profiler, sourceMap, stdout);
+        profiler_deallocate(profiler);
     }
 
+    if(fpgaTiming) {
+        fpgaTiming_report(fpgaTiming, stdout);
+        fpgaTiming_deallocate(fpgaTiming);
+    }
+
+    recorder_destroy(recorder);
+    chip8_deallocateState(runAheadState);
+    hotReload_destroy(hotReload);
+    sourceMap_deallocate(romSourceMap);
+
     UnloadAudioStream(stream);   // Close raw audio stream and delete buffers from RAM
     CloseAudioDevice();         // Close audio device (music streaming is automatically stopped)
+    buzzer_deallocate(buzzer);
 
     CloseWindow();
     return 0;
@@ -0,0 +1,208 @@
+#include "profiler.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define ADDRESS_SPACE 4096
+#define REPORT_ROWS 15
+#define DESCRIPTION_SIZE 160
+#define MAX_DEPTH 16
+
+// one guest call path, a node of the tree rooted at the program entry; children are a sibling list
+typedef struct {
+    uint16_t entry;         // routine entered by the call
+    int32_t parent;
+    int32_t firstChild;
+    int32_t nextSibling;
+    uint64_t instructions;  // executed in this routine itself, not in its callees
+    uint64_t pixels;
+} CallPath;
+
+struct Profiler {
+    uint64_t total;
+    uint64_t hits[ADDRESS_SPACE];
+
+    CallPath* paths;        // paths[0] is the root, code outside of any call
+    int32_t pathCount;
+    int32_t pathCapacity;
+
+    // path the next instruction runs in, as of the last sample
+    int32_t current;
+    uint8_t depth;
+    uint16_t stack[MAX_DEPTH];
+};
+
+typedef struct {
+    char description[DESCRIPTION_SIZE];
+    uint64_t hits;
+} ReportRow;
+
+Profiler* profiler_allocate() {
+    Profiler* p = calloc(1, sizeof(Profiler));
+    p->pathCapacity = 64;
+    p->paths = calloc(p->pathCapacity, sizeof(CallPath));
+    p->paths[0] = (CallPath){ 0x200, -1, -1, -1, 0, 0 };
+    p->pathCount = 1;
+    return p;
+}
+
+void profiler_deallocate(Profiler* p) {
+    if (p == NULL)
+        return;
+    free(p->paths);
+    free(p);
+}
+
+void profiler_sample(Profiler* p, uint16_t pc) {
+    p->hits[pc & (ADDRESS_SPACE - 1)]++;
+    p->total++;
+}
+
+static int32_t childPath(Profiler* p, int32_t parent, uint16_t entry) {
+    for(int32_t child = p->paths[parent].firstChild; child != -1; child = p->paths[child].nextSibling)
+        if (p->paths[child].entry == entry)
+            return child;
+
+    if (p->pathCount == p->pathCapacity) {
+        p->pathCapacity *= 2;
+        p->paths = realloc(p->paths, p->pathCapacity * sizeof(CallPath));
+    }
+    const int32_t child = p->pathCount++;
+    p->paths[child] = (CallPath){ entry, parent, -1, p->paths[parent].firstChild, 0, 0 };
+    p->paths[parent].firstChild = child;
+    return child;
+}
+
+// the stack changes by one call or return at a time, so only the levels past the common prefix are walked again
+void profiler_sampleCalls(Profiler* p, const Chip8* c) {
+    CallPath* path = &p->paths[p->current];
+    path->instructions++;
+    path->pixels += chip8_getDrawnPixels(c);
+
+    const uint16_t* entries;
+    uint8_t depth = chip8_getCallStack(c, &entries);
+    if (depth > MAX_DEPTH)
+        depth = MAX_DEPTH;
+
+    uint8_t common = 0;
+    while (common != depth && common != p->depth && entries[common] == p->stack[common])
+        common++;
+    if (common == depth && common == p->depth)
+        return;
+
+    int32_t node = p->current;
+    for(uint8_t level = p->depth; level != common; level--)
+        node = p->paths[node].parent;
+    for(uint8_t level = common; level != depth; level++) {
+        node = childPath(p, node, entries[level]);
+        p->stack[level] = entries[level];
+    }
+    p->current = node;
+    p->depth = depth;
+}
+
+static void routineName(const SourceMap* map, uint16_t entry, char* out, size_t size) {
+    const char* label;
+    uint16_t labelAddress;
+    if (sourceMap_findLabel(map, entry, &label, &labelAddress) && labelAddress == entry)
+        snprintf(out, size, "%s", label);
+    else
+        sourceMap_describe(map, entry, out, size);
+}
+
+static void writeFolded(const Profiler* p, const SourceMap* map, bool pixels, FILE* out) {
+    char frames[MAX_DEPTH + 1][DESCRIPTION_SIZE];
+    for(int32_t idx = 0; idx != p->pathCount; idx++) {
+        const CallPath* path = &p->paths[idx];
+        const uint64_t value = pixels ? path->pixels : path->instructions;
+        if (value == 0)
+            continue;
+
+        int frameCount = 0;
+        for(int32_t node = idx; node != -1 && frameCount != MAX_DEPTH + 1; node = p->paths[node].parent) {
+            if (node == 0)
+                snprintf(frames[frameCount++], DESCRIPTION_SIZE, "program");
+            else
+                routineName(map, p->paths[node].entry, frames[frameCount++], DESCRIPTION_SIZE);
+        }
+        // frames may not contain the separator
+        for(int frame = frameCount - 1; frame >= 0; frame--) {
+            for(char* it = frames[frame]; *it; it++)
+                if (*it == ';') *it = ',';
+            fprintf(out, frame == frameCount - 1 ? "%s" : ";%s", frames[frame]);
+        }
+        fprintf(out, " %llu\n", (unsigned long long)value);
+    }
+}
+
+bool profiler_writeFolded(const Profiler* p, const SourceMap* map, const char* pathPrefix) {
+    char path[4096];
+    bool success = true;
+    const char* suffixes[2] = { ".folded", "-pixels.folded" };
+    for(int metric = 0; metric != 2; metric++) {
+        snprintf(path, sizeof(path), "%s%s", pathPrefix, suffixes[metric]);
+        FILE* out = fopen(path, "w");
+        if (out == NULL) {
+            printf("couldn't write %s\n", path);
+            success = false;
+            continue;
+        }
+        writeFolded(p, map, metric == 1, out);
+        fclose(out);
+    }
+    return success;
+}
+
+static int byHitsDescending(const void* a, const void* b) {
+    const uint64_t hitsA = ((const ReportRow*)a)->hits, hitsB = ((const ReportRow*)b)->hits;
+    return hitsA < hitsB ? 1 : hitsA > hitsB ? -1 : 0;
+}
+
+static void printRows(ReportRow* rows, int rowCount, uint64_t total, const char* title, FILE* out) {
+    qsort(rows, rowCount, sizeof(ReportRow), byHitsDescending);
+    fprintf(out, "%s\n", title);
+    for(int idx = 0; idx != rowCount && idx != REPORT_ROWS; idx++)
+        fprintf(out, "  %6.2f%%  %12llu  %s\n", 100.0 * (double)rows[idx].hits / (double)total, (unsigned long long)rows[idx].hits, rows[idx].description);
+}
+
+// addresses are walked in order, code of one line (or one routine) is contiguous, so equal neighbours are merged
+void profiler_report(const Profiler* p, const SourceMap* map, FILE* out) {
+    if (p->total == 0)
+        return;
+
+    ReportRow* lines = calloc(ADDRESS_SPACE, sizeof(ReportRow));
+    ReportRow* routines = calloc(ADDRESS_SPACE, sizeof(ReportRow));
+    int lineCount = 0, routineCount = 0;
+
+    for(int address = 0; address != ADDRESS_SPACE; address++) {
+        if (p->hits[address] == 0)
+            continue;
+
+        char line[DESCRIPTION_SIZE];
+        const char* file;
+        int lineNumber;
+        if (sourceMap_findLine(map, address, &file, &lineNumber))
+            snprintf(line, sizeof(line), "%s:%d", file, lineNumber);
+        else
+            snprintf(line, sizeof(line), "0x%03x", address);
+
+        if (lineCount == 0 || strcmp(lines[lineCount - 1].description, line) != 0)
+            strcpy(lines[lineCount++].description, line);
+        lines[lineCount - 1].hits += p->hits[address];
+
+        const char* label;
+        uint16_t labelAddress;
+        if (!sourceMap_findLabel(map, address, &label, &labelAddress))
+            label = "<no label>";
+        if (routineCount == 0 || strcmp(routines[routineCount - 1].description, label) != 0)
+            snprintf(routines[routineCount++].description, DESCRIPTION_SIZE, "%s", label);
+        routines[routineCount - 1].hits += p->hits[address];
+    }
+
+    fprintf(out, "profile: %llu instructions\n", (unsigned long long)p->total);
+    printRows(routines, routineCount, p->total, "hottest routines:", out);
+    printRows(lines, lineCount, p->total, "hottest lines:", out);
+
+    free(lines);
+    free(routines);
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include "chip8.h"
+#include "sourceMap.h"
+
+// counts executed instructions per address, reported per source line and per routine (label);
+// with the core tracking calls, also per guest call path, with the pixels Dxyn flipped along each
+
+struct Profiler;
+typedef struct Profiler Profiler;
+
+Profiler* profiler_allocate();
+void profiler_deallocate(Profiler*);
+
+// call with the program counter before every instruction
+void profiler_sample(Profiler*, uint16_t pc);
+
+// call after every instruction, with chip8_setCallTracking enabled on c
+void profiler_sampleCalls(Profiler*, const Chip8* c);
+
+// hottest lines and routines; without a source map, hottest addresses
+void profiler_report(const Profiler*, const SourceMap*, FILE* out);
+
+// folded stacks ("program;GAME;drawPipe 1234" per line, for flamegraph.pl and compatible viewers),
+// instructions to <pathPrefix>.folded and pixel work to <pathPrefix>-pixels.folded
+bool profiler_writeFolded(const Profiler*, const SourceMap*, const char* pathPrefix);
@@ -0,0 +1,287 @@
+#include "recorder.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FORMAT_VERSION 1
+#define WIDTH 64
+#define HEIGHT 32
+#define ROW_BYTES (WIDTH / 8)
+#define RECORD_REPEAT 0x00
+#define RECORD_FRAME 0x01
+#define RECORD_BUZZER 0x02
+#define RLE_ZEROES 0x80
+#define RLE_MAX_RUN 128
+#define FLUSH_FRAMES 60             // at most a second of capture is lost when the process dies
+
+static const char magic[5] = { 'C', '8', 'R', 'E', 'C' };
+
+struct Recorder {
+    FILE* file;
+    uint8_t last[RECORDING_FRAME_BYTES];
+    bool lastBuzzer;
+    uint64_t repeats;               // frames equal to the last one, not written yet
+    uint32_t framesSinceFlush;
+};
+
+struct Recording {
+    FILE* file;
+    uint8_t current[RECORDING_FRAME_BYTES];
+    bool buzzer;
+    uint64_t repeats;
+    uint64_t frame;
+};
+
+void recording_packFrame(const Chip8* c, uint8_t frame[RECORDING_FRAME_BYTES]) {
+    uint8_t* out = frame;
+    const Chip8Framebuffer screen = chip8_getFramebuffer(c);
+    for(int y = 0; y != screen.height; y++) {
+        const uint32_t* row = (const uint32_t*)((const uint8_t*)screen.pixels + y * screen.stride);
+        for(int x = 0; x != screen.width; x += 8) {
+            uint8_t bits = 0;
+            for(int bit = 0; bit != 8; bit++)
+                bits = (uint8_t)(bits << 1 | (row[x + bit] != 0));
+            *out++ = bits;
+        }
+    }
+}
+
+// runs of zero bytes, the bulk of a delta, and runs of literal bytes, each up to RLE_MAX_RUN long
+static size_t encodeRle(const uint8_t* in, size_t size, uint8_t* out) {
+    size_t written = 0;
+    for(size_t position = 0; position < size;) {
+        const bool zeroes = in[position] == 0;
+        size_t run = 1;
+        while (position + run < size && run < RLE_MAX_RUN && (in[position + run] == 0) == zeroes)
+            run++;
+        out[written++] = (uint8_t)((zeroes ? RLE_ZEROES : 0) | (run - 1));
+        if (!zeroes) {
+            memcpy(&out[written], &in[position], run);
+            written += run;
+        }
+        position += run;
+    }
+    return written;
+}
+
+size_t recording_encodeFrame(const uint8_t last[RECORDING_FRAME_BYTES], const uint8_t frame[RECORDING_FRAME_BYTES], bool buzzer, uint8_t* record) {
+    uint8_t delta[RECORDING_FRAME_BYTES];
+    size_t deltaSize = 0;
+    uint32_t rows = 0;
+    for(int y = 0; y != HEIGHT; y++) {
+        const uint8_t* now = &frame[y * ROW_BYTES];
+        const uint8_t* before = &last[y * ROW_BYTES];
+        if (memcmp(now, before, ROW_BYTES) == 0)
+            continue;
+        rows |= 1u << y;
+        for(int idx = 0; idx != ROW_BYTES; idx++)
+            delta[deltaSize++] = now[idx] ^ before[idx];
+    }
+
+    record[0] = RECORD_FRAME | (buzzer ? RECORD_BUZZER : 0);
+    for(int idx = 0; idx != 4; idx++)
+        record[1 + idx] = (uint8_t)(rows >> (8 * idx));
+    return 5 + encodeRle(delta, deltaSize, &record[5]);
+}
+
+static void writeRepeats(Recorder* r) {
+    if (r->repeats == 0)
+        return;
+    uint8_t record[1 + 10] = { RECORD_REPEAT };
+    size_t size = 1;
+    for(uint64_t count = r->repeats; ; count >>= 7) {
+        record[size++] = (uint8_t)((count & 0x7F) | (count > 0x7F ? 0x80 : 0));
+        if (count <= 0x7F)
+            break;
+    }
+    fwrite(record, 1, size, r->file);
+    r->repeats = 0;
+}
+
+void recording_writeHeader(uint8_t header[RECORDING_HEADER_BYTES]) {
+    memcpy(header, magic, sizeof(magic));
+    header[5] = FORMAT_VERSION;
+    header[6] = WIDTH;
+    header[7] = HEIGHT;
+}
+
+bool recording_checkHeader(const uint8_t header[RECORDING_HEADER_BYTES]) {
+    return memcmp(header, magic, sizeof(magic)) == 0 && header[5] == FORMAT_VERSION && header[6] == WIDTH && header[7] == HEIGHT;
+}
+
+Recorder* recorder_create(const char* path) {
+    FILE* file = fopen(path, "wb");
+    if (file == NULL)
+        return NULL;
+
+    uint8_t header[RECORDING_HEADER_BYTES];
+    recording_writeHeader(header);
+    fwrite(header, 1, sizeof(header), file);
+
+    Recorder* r = calloc(1, sizeof(Recorder));
+    r->file = file;
+    return r;
+}
+
+void recorder_destroy(Recorder* r) {
+    if (r == NULL)
+        return;
+    writeRepeats(r);
+    fclose(r->file);
+    free(r);
+}
+
+void recorder_captureFrame(Recorder* r, const Chip8* c) {
+    if (++r->framesSinceFlush == FLUSH_FRAMES) {
+        fflush(r->file);
+        r->framesSinceFlush = 0;
+    }
+
+    uint8_t frame[RECORDING_FRAME_BYTES];
+    recording_packFrame(c, frame);
+    const bool buzzer = chip8_getBuzzer(c);
+    if (buzzer == r->lastBuzzer && memcmp(frame, r->last, RECORDING_FRAME_BYTES) == 0) {
+        r->repeats++;
+        return;
+    }
+    writeRepeats(r);
+
+    uint8_t record[RECORDING_MAX_RECORD_BYTES];
+    const size_t size = recording_encodeFrame(r->last, frame, buzzer, record);
+    fwrite(record, 1, size, r->file);
+
+    memcpy(r->last, frame, RECORDING_FRAME_BYTES);
+    r->lastBuzzer = buzzer;
+}
+
+Recording* recording_open(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (file == NULL)
+        return NULL;
+
+    uint8_t header[RECORDING_HEADER_BYTES];
+    if (fread(header, 1, sizeof(header), file) != sizeof(header) || !recording_checkHeader(header)) {
+        fclose(file);
+        return NULL;
+    }
+
+    Recording* r = calloc(1, sizeof(Recording));
+    r->file = file;
+    return r;
+}
+
+void recording_close(Recording* r) {
+    if (r == NULL)
+        return;
+    fclose(r->file);
+    free(r);
+}
+
+static size_t deltaSizeOf(uint32_t rows) {
+    size_t deltaSize = 0;
+    for(int y = 0; y != HEIGHT; y++)
+        deltaSize += (rows >> y & 1) * ROW_BYTES;
+    return deltaSize;
+}
+
+static void applyDelta(uint8_t pixels[RECORDING_FRAME_BYTES], uint32_t rows, const uint8_t* delta) {
+    for(int y = 0; y != HEIGHT; y++) {
+        if (!(rows >> y & 1))
+            continue;
+        for(int idx = 0; idx != ROW_BYTES; idx++)
+            pixels[y * ROW_BYTES + idx] ^= *delta++;
+    }
+}
+
+static bool readFrameRecord(Recording* r, int tag) {
+    uint8_t bytes[4];
+    if (fread(bytes, 1, 4, r->file) != 4)
+        return false;
+    const uint32_t rows = (uint32_t)(bytes[0] | bytes[1] << 8 | bytes[2] << 16 | (uint32_t)bytes[3] << 24);
+
+    uint8_t delta[RECORDING_FRAME_BYTES];
+    const size_t deltaSize = deltaSizeOf(rows);
+    for(size_t position = 0; position < deltaSize;) {
+        const int token = fgetc(r->file);
+        if (token == EOF)
+            return false;
+        const size_t run = (size_t)(token & ~RLE_ZEROES) + 1;
+        if (position + run > deltaSize)
+            return false;
+        if (token & RLE_ZEROES)
+            memset(&delta[position], 0, run);
+        else if (fread(&delta[position], 1, run, r->file) != run)
+            return false;
+        position += run;
+    }
+
+    applyDelta(r->current, rows, delta);
+    r->buzzer = tag & RECORD_BUZZER;
+    return true;
+}
+
+bool recording_nextFrame(Recording* r, uint8_t pixels[RECORDING_FRAME_BYTES], bool* buzzer, uint64_t* frame) {
+    if (r->repeats == 0) {
+        const int tag = fgetc(r->file);
+        if (tag == EOF)
+            return false;
+        if (tag == RECORD_REPEAT) {
+            for(int shift = 0; ; shift += 7) {
+                const int byte = fgetc(r->file);
+                if (byte == EOF || shift > 63)
+                    return false;
+                r->repeats |= (uint64_t)(byte & 0x7F) << shift;
+                if (!(byte & 0x80))
+                    break;
+            }
+            if (r->repeats == 0)
+                return false;
+            r->repeats--;
+        }
+        else if ((tag & ~RECORD_BUZZER) != RECORD_FRAME || !readFrameRecord(r, tag))
+            return false;
+    }
+    else
+        r->repeats--;
+
+    memcpy(pixels, r->current, RECORDING_FRAME_BYTES);
+    *buzzer = r->buzzer;
+    *frame = r->frame++;
+    return true;
+}
+
+int recording_decodeFrame(const uint8_t* record, size_t size, uint8_t pixels[RECORDING_FRAME_BYTES], bool* buzzer) {
+    if (size == 0)
+        return 0;
+    if ((record[0] & ~RECORD_BUZZER) != RECORD_FRAME)
+        return -1;
+    if (size < 5)
+        return 0;
+    const uint32_t rows = (uint32_t)(record[1] | record[2] << 8 | record[3] << 16 | (uint32_t)record[4] << 24);
+
+    uint8_t delta[RECORDING_FRAME_BYTES];
+    const size_t deltaSize = deltaSizeOf(rows);
+    size_t used = 5;
+    for(size_t position = 0; position < deltaSize;) {
+        if (used == size)
+            return 0;
+        const uint8_t token = record[used++];
+        const size_t run = (size_t)(token & ~RLE_ZEROES) + 1;
+        if (position + run > deltaSize)
+            return -1;
+        if (token & RLE_ZEROES)
+            memset(&delta[position], 0, run);
+        else {
+            if (size - used < run)
+                return 0;
+            memcpy(&delta[position], &record[used], run);
+            used += run;
+        }
+        position += run;
+    }
+
+    applyDelta(pixels, rows, delta);
+    *buzzer = record[0] & RECORD_BUZZER;
+    return (int)used;
+}
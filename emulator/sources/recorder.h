@@ -0,0 +1,52 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include "chip8.h"
+
+// gameplay capture: the screen and the buzzer after every frame, delta encoded into a .c8rec file
+//
+//   file   := "C8REC" version(1) width(64) height(32) record*
+//   record := 0x00 count(varint)               count more frames equal to the last one
+//           | 0x01 | buzzer << 1  rows(u32 le)  rle(...)
+//                                              a changed frame: bit y of rows is set for every row that changed,
+//                                              rle holds those rows XORed with their last value, 8 bytes each
+//   rle    := (0x80 | n-1 : n zero bytes | n-1 byte*n : n literal bytes)*, up to the size of the changed rows
+//
+// frames are numbered by their position, from 0; a frame is 64x32 pixels, rows of 8 bytes, leftmost pixel in the high bit
+
+#define RECORDING_FRAME_BYTES (64 * 32 / 8)
+#define RECORDING_HEADER_BYTES 8
+#define RECORDING_MAX_RECORD_BYTES (1 + 4 + RECORDING_FRAME_BYTES * 3 / 2)   // rle at worst: a literal byte, a zero byte, again
+
+struct Recorder;
+typedef struct Recorder Recorder;
+
+// NULL when the file can't be created
+Recorder* recorder_create(const char* path);
+// writes what is still pending and closes the file
+void recorder_destroy(Recorder*);
+
+// call after every chip8_fixedUpdate
+void recorder_captureFrame(Recorder*, const Chip8* c);
+
+struct Recording;
+typedef struct Recording Recording;
+
+// NULL when the file is missing or not a recording
+Recording* recording_open(const char* path);
+void recording_close(Recording*);
+
+// the next frame, false at the end of the recording or on a damaged record
+bool recording_nextFrame(Recording*, uint8_t pixels[RECORDING_FRAME_BYTES], bool* buzzer, uint64_t* frame);
+
+// the format piece by piece, for live streams (streamServer) sending the same header and frame records over a socket
+
+void recording_writeHeader(uint8_t header[RECORDING_HEADER_BYTES]);
+bool recording_checkHeader(const uint8_t header[RECORDING_HEADER_BYTES]);
+// the screen of c as a frame
+void recording_packFrame(const Chip8* c, uint8_t frame[RECORDING_FRAME_BYTES]);
+// writes the frame record turning last into frame and returns its size, at most RECORDING_MAX_RECORD_BYTES
+size_t recording_encodeFrame(const uint8_t last[RECORDING_FRAME_BYTES], const uint8_t frame[RECORDING_FRAME_BYTES], bool buzzer, uint8_t* record);
+// applies the frame record at the start of the size bytes to pixels and returns its size;
+// 0 when they only hold the beginning of it, -1 when it isn't a frame record or is damaged
+int recording_decodeFrame(const uint8_t* record, size_t size, uint8_t pixels[RECORDING_FRAME_BYTES], bool* buzzer);
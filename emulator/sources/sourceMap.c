@@ -0,0 +1,215 @@
+#include "sourceMap.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    uint16_t address;
+    uint16_t file;
+    uint32_t line;
+} SourceLocation;
+
+struct SourceMap {
+    uint16_t fileCount;
+    char** files;
+
+    uint16_t labelCount;
+    uint16_t* labelAddresses;   // ascending
+    char** labels;
+
+    uint32_t locationCount;
+    SourceLocation* locations;  // ascending by address
+};
+
+typedef struct {
+    const uint8_t* data;
+    size_t size;
+    size_t position;
+} Reader;
+
+static bool readU16(Reader* r, uint16_t* out) {
+    if (r->position + 2 > r->size) return false;
+    *out = (uint16_t)(r->data[r->position] | r->data[r->position + 1] << 8);
+    r->position += 2;
+    return true;
+}
+
+static bool readU32(Reader* r, uint32_t* out) {
+    uint16_t low, high;
+    if (!readU16(r, &low) || !readU16(r, &high)) return false;
+    *out = (uint32_t)low | (uint32_t)high << 16;
+    return true;
+}
+
+static char* readName(Reader* r) {
+    uint16_t length;
+    if (!readU16(r, &length) || r->position + length > r->size) return NULL;
+    char* name = malloc(length + 1);
+    memcpy(name, r->data + r->position, length);
+    name[length] = '\0';
+    r->position += length;
+    return name;
+}
+
+SourceMap* sourceMap_loadFromMemory(const uint8_t* data, size_t size) {
+    Reader r = { data, size, 0 };
+    uint16_t version;
+    if (size < 4 || memcmp(data, "C8SM", 4) != 0) return NULL;
+    r.position = 4;
+    if (!readU16(&r, &version) || version != 1) return NULL;
+
+    SourceMap* m = calloc(1, sizeof(SourceMap));
+    bool valid = readU16(&r, &m->fileCount);
+    if (valid) {
+        m->files = calloc(m->fileCount, sizeof(char*));
+        for(int idx = 0; valid && idx != m->fileCount; idx++)
+            valid = (m->files[idx] = readName(&r)) != NULL;
+    }
+
+    valid = valid && readU16(&r, &m->labelCount);
+    if (valid) {
+        m->labels = calloc(m->labelCount, sizeof(char*));
+        m->labelAddresses = calloc(m->labelCount, sizeof(uint16_t));
+        for(int idx = 0; valid && idx != m->labelCount; idx++)
+            valid = readU16(&r, &m->labelAddresses[idx]) && (m->labels[idx] = readName(&r)) != NULL;
+    }
+
+    valid = valid && readU32(&r, &m->locationCount) && m->locationCount <= (r.size - r.position) / 8;
+    if (valid) {
+        m->locations = calloc(m->locationCount, sizeof(SourceLocation));
+        for(uint32_t idx = 0; valid && idx != m->locationCount; idx++) {
+            SourceLocation* l = &m->locations[idx];
+            valid = readU16(&r, &l->address) && readU16(&r, &l->file) && readU32(&r, &l->line) && l->file < m->fileCount;
+        }
+    }
+
+    if (!valid) {
+        sourceMap_deallocate(m);
+        return NULL;
+    }
+    return m;
+}
+
+SourceMap* sourceMap_loadFromPath(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (file == NULL)
+        return NULL;
+
+    fseek(file, 0, SEEK_END);
+    const long length = ftell(file);
+    rewind(file);
+
+    SourceMap* m = NULL;
+    uint8_t* data = malloc(length > 0 ? length : 1);
+    if (length > 0 && fread(data, 1, length, file) == (size_t)length)
+        m = sourceMap_loadFromMemory(data, length);
+    free(data);
+    fclose(file);
+    return m;
+}
+
+void sourceMap_deallocate(SourceMap* m) {
+    if (m == NULL)
+        return;
+    for(int idx = 0; m->files && idx != m->fileCount; idx++)
+        free(m->files[idx]);
+    for(int idx = 0; m->labels && idx != m->labelCount; idx++)
+        free(m->labels[idx]);
+    free(m->files);
+    free(m->labels);
+    free(m->labelAddresses);
+    free(m->locations);
+    free(m);
+}
+
+bool sourceMap_findLine(const SourceMap* m, uint16_t address, const char** file, int* line) {
+    if (m == NULL || m->locationCount == 0 || address < m->locations[0].address)
+        return false;
+
+    // last location at or before address
+    uint32_t low = 0, high = m->locationCount;
+    while (high - low > 1) {
+        const uint32_t middle = (low + high) / 2;
+        if (m->locations[middle].address <= address) low = middle;
+        else high = middle;
+    }
+
+    *file = m->files[m->locations[low].file];
+    *line = (int)m->locations[low].line;
+    return true;
+}
+
+bool sourceMap_findLabel(const SourceMap* m, uint16_t address, const char** label, uint16_t* labelAddress) {
+    if (m == NULL || m->labelCount == 0 || address < m->labelAddresses[0])
+        return false;
+
+    int low = 0, high = m->labelCount;
+    while (high - low > 1) {
+        const int middle = (low + high) / 2;
+        if (m->labelAddresses[middle] <= address) low = middle;
+        else high = middle;
+    }
+
+    *label = m->labels[low];
+    *labelAddress = m->labelAddresses[low];
+    return true;
+}
+
+static bool sameFile(const char* path, const char* name) {
+    const size_t pathLength = strlen(path), nameLength = strlen(name);
+    if (pathLength < nameLength || strcmp(path + pathLength - nameLength, name) != 0)
+        return false;
+    return pathLength == nameLength || path[pathLength - nameLength - 1] == '/' || path[pathLength - nameLength - 1] == '\\';
+}
+
+bool sourceMap_findAddress(const SourceMap* m, const char* location, uint16_t* address) {
+    if (m == NULL)
+        return false;
+
+    for(int idx = 0; idx != m->labelCount; idx++) {
+        if (strcmp(m->labels[idx], location) == 0) {
+            *address = m->labelAddresses[idx];
+            return true;
+        }
+    }
+
+    const char* colon = strrchr(location, ':');
+    if (colon == NULL)
+        return false;
+
+    char fileName[256];
+    const size_t fileNameLength = (size_t)(colon - location);
+    if (fileNameLength >= sizeof(fileName))
+        return false;
+    memcpy(fileName, location, fileNameLength);
+    fileName[fileNameLength] = '\0';
+    const long line = strtol(colon + 1, NULL, 10);
+
+    for(uint32_t idx = 0; idx != m->locationCount; idx++) {
+        const SourceLocation* l = &m->locations[idx];
+        if (l->line == (uint32_t)line && sameFile(m->files[l->file], fileName)) {
+            *address = l->address;
+            return true;
+        }
+    }
+    return false;
+}
+
+int sourceMap_describe(const SourceMap* m, uint16_t address, char* out, size_t size) {
+    const char* file;
+    int line;
+    const char* label;
+    uint16_t labelAddress;
+
+    const bool hasLine = sourceMap_findLine(m, address, &file, &line);
+    const bool hasLabel = sourceMap_findLabel(m, address, &label, &labelAddress);
+
+    if (hasLine && hasLabel && address == labelAddress)
+        return snprintf(out, size, "%s:%d (%s)", file, line, label);
+    if (hasLine && hasLabel)
+        return snprintf(out, size, "%s:%d (%s+0x%x)", file, line, label, address - labelAddress);
+    if (hasLine)
+        return snprintf(out, size, "%s:%d", file, line);
+    return snprintf(out, size, "0x%03x", address);
+}
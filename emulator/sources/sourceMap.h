@@ -0,0 +1,23 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// address -> (file, line, label) map written by chip8Asm next to the rom (.c8map)
+
+struct SourceMap;
+typedef struct SourceMap SourceMap;
+
+SourceMap* sourceMap_loadFromPath(const char* path);                     // NULL when missing or not a source map
+SourceMap* sourceMap_loadFromMemory(const uint8_t* data, size_t size);   // NULL when not a source map
+void sourceMap_deallocate(SourceMap*);
+
+// file and line the byte at address was assembled from, false before the program
+bool sourceMap_findLine(const SourceMap*, uint16_t address, const char** file, int* line);
+// nearest label at or before address, the routine it belongs to; false before the first label
+bool sourceMap_findLabel(const SourceMap*, uint16_t address, const char** label, uint16_t* labelAddress);
+// address of a label, or of the first byte of file:line (file may be given without its directory)
+bool sourceMap_findAddress(const SourceMap*, const char* location, uint16_t* address);
+
+// "file:line (label+0x4)" or just the hex address when it isn't mapped, as snprintf
+int sourceMap_describe(const SourceMap*, uint16_t address, char* out, size_t size);
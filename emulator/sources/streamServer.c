@@ -0,0 +1,208 @@
+#define _POSIX_C_SOURCE 200809L
+#include "streamServer.h"
+#include "recorder.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define MAX_VIEWERS 16
+#define NO_INSTANCE UINT32_MAX
+#define PENDING_BYTES (RECORDING_HEADER_BYTES + RECORDING_MAX_RECORD_BYTES)
+
+typedef struct {
+    int socket;                     // -1 for a free slot
+    uint32_t instance;
+    bool restart;                   // a header and a fresh start are due once pending is out
+    uint16_t heldKeys;
+    uint8_t last[RECORDING_FRAME_BYTES];    // the frame as the viewer has it once pending is out
+    bool lastBuzzer;
+    uint8_t input[STREAM_MESSAGE_BYTES];
+    uint32_t inputSize;
+    uint8_t pending[PENDING_BYTES];
+    uint32_t pendingSize;
+} Viewer;
+
+struct StreamServer {
+    int listener;
+    char path[sizeof(((struct sockaddr_un*)0)->sun_path)];
+    Chip8* const* instances;
+    uint32_t count;
+    Viewer viewers[MAX_VIEWERS];
+    uint32_t viewerCount;
+};
+
+static bool setNonBlocking(int fd) {
+    const int flags = fcntl(fd, F_GETFL, 0);
+    return flags != -1 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) != -1;
+}
+
+StreamServer* streamServer_create(const char* socketPath, Chip8* const* instances, uint32_t count) {
+    struct sockaddr_un address = { .sun_family = AF_UNIX };
+    if (strlen(socketPath) >= sizeof(address.sun_path)) {
+        printf("stream: socket path %s is too long\n", socketPath);
+        return NULL;
+    }
+    strcpy(address.sun_path, socketPath);
+
+    const int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener == -1)
+        return NULL;
+    unlink(socketPath);
+    if (bind(listener, (const struct sockaddr*)&address, sizeof(address)) != 0 || listen(listener, MAX_VIEWERS) != 0
+        || !setNonBlocking(listener)) {
+        printf("stream: can't listen on %s: %s\n", socketPath, strerror(errno));
+        close(listener);
+        return NULL;
+    }
+
+    StreamServer* s = calloc(1, sizeof(StreamServer));
+    s->listener = listener;
+    strcpy(s->path, socketPath);
+    s->instances = instances;
+    s->count = count;
+    for(int idx = 0; idx != MAX_VIEWERS; idx++)
+        s->viewers[idx].socket = -1;
+    return s;
+}
+
+static void releaseKeys(StreamServer* s, Viewer* v) {
+    if (v->instance == NO_INSTANCE)
+        return;
+    for(uint8_t key = 0; key != 16; key++)
+        if (v->heldKeys >> key & 1)
+            chip8_setKeyPressed(s->instances[v->instance], key, false);
+    v->heldKeys = 0;
+}
+
+static void disconnect(StreamServer* s, Viewer* v) {
+    releaseKeys(s, v);
+    close(v->socket);
+    v->socket = -1;
+    s->viewerCount--;
+}
+
+void streamServer_destroy(StreamServer* s) {
+    if (s == NULL)
+        return;
+    for(int idx = 0; idx != MAX_VIEWERS; idx++)
+        if (s->viewers[idx].socket != -1)
+            disconnect(s, &s->viewers[idx]);
+    close(s->listener);
+    unlink(s->path);
+    free(s);
+}
+
+uint32_t streamServer_viewerCount(const StreamServer* s) {
+    return s->viewerCount;
+}
+
+static void acceptViewers(StreamServer* s) {
+    for(;;) {
+        const int fd = accept(s->listener, NULL, NULL);
+        if (fd == -1)
+            return;
+        Viewer* v = NULL;
+        for(int idx = 0; idx != MAX_VIEWERS && v == NULL; idx++)
+            if (s->viewers[idx].socket == -1)
+                v = &s->viewers[idx];
+        if (v == NULL || !setNonBlocking(fd)) {
+            close(fd);
+            continue;
+        }
+        *v = (Viewer){ .socket = fd, .instance = NO_INSTANCE };
+        s->viewerCount++;
+    }
+}
+
+// false when the viewer has to go: a message that makes no sense
+static bool handleMessage(StreamServer* s, Viewer* v, const uint8_t message[STREAM_MESSAGE_BYTES]) {
+    if (message[0] == STREAM_ATTACH) {
+        const uint32_t instance = (uint32_t)(message[1] | message[2] << 8);
+        if (instance >= s->count)
+            return false;
+        releaseKeys(s, v);
+        v->instance = instance;
+        v->restart = true;
+        return true;
+    }
+    if (message[0] == STREAM_KEY) {
+        const uint8_t key = message[1];
+        if (key >= 16 || v->instance == NO_INSTANCE)
+            return false;
+        chip8_setKeyPressed(s->instances[v->instance], key, message[2] != 0);
+        v->heldKeys = (uint16_t)(message[2] != 0 ? v->heldKeys | 1 << key : v->heldKeys & ~(1 << key));
+        return true;
+    }
+    return false;
+}
+
+static bool readMessages(StreamServer* s, Viewer* v) {
+    for(;;) {
+        const ssize_t size = recv(v->socket, &v->input[v->inputSize], STREAM_MESSAGE_BYTES - v->inputSize, 0);
+        if (size == 0)
+            return false;
+        if (size < 0)
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+        v->inputSize += (uint32_t)size;
+        if (v->inputSize == STREAM_MESSAGE_BYTES) {
+            v->inputSize = 0;
+            if (!handleMessage(s, v, v->input))
+                return false;
+        }
+    }
+}
+
+static bool flushPending(Viewer* v) {
+    while (v->pendingSize != 0) {
+        const ssize_t size = send(v->socket, v->pending, v->pendingSize, MSG_NOSIGNAL);
+        if (size < 0)
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+        memmove(v->pending, &v->pending[size], v->pendingSize - (size_t)size);
+        v->pendingSize -= (uint32_t)size;
+    }
+    return true;
+}
+
+void streamServer_update(StreamServer* s) {
+    acceptViewers(s);
+    if (s->viewerCount == 0)
+        return;
+
+    for(int idx = 0; idx != MAX_VIEWERS; idx++) {
+        Viewer* v = &s->viewers[idx];
+        if (v->socket == -1)
+            continue;
+        if (!readMessages(s, v) || !flushPending(v)) {
+            disconnect(s, v);
+            continue;
+        }
+        // still busy with an older frame: this one is dropped, the next record starts from what it was sent
+        if (v->instance == NO_INSTANCE || v->pendingSize != 0)
+            continue;
+        if (v->restart) {
+            recording_writeHeader(v->pending);
+            v->pendingSize = RECORDING_HEADER_BYTES;
+            memset(v->last, 0, RECORDING_FRAME_BYTES);
+            v->lastBuzzer = false;
+            v->restart = false;
+        }
+
+        const Chip8* c = s->instances[v->instance];
+        uint8_t frame[RECORDING_FRAME_BYTES];
+        recording_packFrame(c, frame);
+        const bool buzzer = chip8_getBuzzer(c);
+        if (buzzer != v->lastBuzzer || memcmp(frame, v->last, RECORDING_FRAME_BYTES) != 0) {
+            v->pendingSize += (uint32_t)recording_encodeFrame(v->last, frame, buzzer, &v->pending[v->pendingSize]);
+            memcpy(v->last, frame, RECORDING_FRAME_BYTES);
+            v->lastBuzzer = buzzer;
+        }
+        if (!flushPending(v))
+            disconnect(s, v);
+    }
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include "chip8.h"
+
+// live view into a batch of headless instances over a unix domain socket; nothing is encoded for instances nobody watches
+//
+// a viewer connects and sends 4 byte messages:
+//   'A' instance(u16 le) 0     watch an instance, again at any time to switch to another one
+//   'K' key down(0 or 1) 0     press or release a key of the watched instance
+// after each 'A' the server answers with a .c8rec header (see recorder.h), then a frame record for every frame that
+// changed, the first one against a blank screen; frames are dropped while a viewer doesn't keep up, the next record
+// goes from the last one it was sent. The keys a viewer holds are released when it switches or disconnects.
+
+#define STREAM_ATTACH 'A'
+#define STREAM_KEY 'K'
+#define STREAM_MESSAGE_BYTES 4
+
+struct StreamServer;
+typedef struct StreamServer StreamServer;
+
+// listens on socketPath (replacing a stale socket file there), NULL on failure; instances stay owned by the caller
+StreamServer* streamServer_create(const char* socketPath, Chip8* const* instances, uint32_t count);
+// disconnects the viewers and removes the socket file
+void streamServer_destroy(StreamServer*);
+
+// call after every chip8_fixedUpdate of the batch, from the thread running it: takes new viewers and their key
+// events, sends the watched instances' frames; never blocks
+void streamServer_update(StreamServer*);
+uint32_t streamServer_viewerCount(const StreamServer*);
@@ -0,0 +1,94 @@
+// recorderRoundTrip: captures frames into a .c8rec file and checks that reading it back gives the same frames
+
+#include "chip8.h"
+#include "recorder.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FRAMES 4
+#define INSTRUCTIONS_PER_FRAME 1000
+#define CAPTURE_PATH "recorderRoundTrip.c8rec"
+
+// 0xFF sprite rows at x = 0, 16, 32 and 48 down the whole screen in one frame, then cls: rows of alternating
+// 0xFF and 0x00 bytes are the worst case of the rle, 12 bytes for 8, a record of 5 + 384 bytes both ways
+static const uint8_t worstCaseRom[] = {
+    0x60, 0x00, 0x61, 0x00, 0xA2, 0x40, 0x61, 0x00, 0x60, 0x00, 0xD0, 0x1F,
+    0x60, 0x10, 0xD0, 0x1F, 0x60, 0x20, 0xD0, 0x1F, 0x60, 0x30, 0xD0, 0x1F,
+    0x61, 0x0F, 0x60, 0x00, 0xD0, 0x1F, 0x60, 0x10, 0xD0, 0x1F, 0x60, 0x20,
+    0xD0, 0x1F, 0x60, 0x30, 0xD0, 0x1F, 0x61, 0x1E, 0x60, 0x00, 0xD0, 0x12,
+    0x60, 0x10, 0xD0, 0x12, 0x60, 0x20, 0xD0, 0x12, 0x60, 0x30, 0xD0, 0x12,
+    0x00, 0xE0, 0x12, 0x3E, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+};
+
+static void packFrame(const Chip8* c, uint8_t* out) {
+    const Chip8Framebuffer screen = chip8_getFramebuffer(c);
+    memset(out, 0, RECORDING_FRAME_BYTES);
+    for(int y = 0; y != screen.height; y++) {
+        const uint32_t* row = (const uint32_t*)((const uint8_t*)screen.pixels + y * screen.stride);
+        for(int x = 0; x != screen.width; x++)
+            if (row[x] != 0)
+                out[y * 8 + x / 8] |= (uint8_t)(0x80 >> (x % 8));
+    }
+}
+
+int main(void) {
+    Chip8* c = chip8_allocate();
+    if (!chip8_loadProgramFromMemory(c, worstCaseRom, sizeof(worstCaseRom))) {
+        printf("can't load the rom\n");
+        return EXIT_FAILURE;
+    }
+
+    static uint8_t expected[FRAMES][RECORDING_FRAME_BYTES];
+    bool expectedBuzzer[FRAMES];
+    Recorder* r = recorder_create(CAPTURE_PATH);
+    if (r == NULL) {
+        printf("can't create %s\n", CAPTURE_PATH);
+        return EXIT_FAILURE;
+    }
+    for(int frame = 0; frame != FRAMES; frame++) {
+        chip8_run(c, INSTRUCTIONS_PER_FRAME);
+        chip8_fixedUpdate(c);
+        recorder_captureFrame(r, c);
+        packFrame(c, expected[frame]);
+        expectedBuzzer[frame] = chip8_getBuzzer(c);
+    }
+    recorder_destroy(r);
+    chip8_deallocate(c);
+
+    int failures = 0;
+    if (expected[0][0] != 0xFF || expected[0][1] != 0x00 || expected[0][RECORDING_FRAME_BYTES - 2] != 0xFF) {
+        printf("the rom didn't draw the worst case frame\n");
+        failures++;
+    }
+
+    Recording* in = recording_open(CAPTURE_PATH);
+    if (in == NULL) {
+        printf("can't open %s\n", CAPTURE_PATH);
+        return EXIT_FAILURE;
+    }
+    uint8_t pixels[RECORDING_FRAME_BYTES];
+    bool buzzer;
+    uint64_t frame;
+    int read = 0;
+    while (recording_nextFrame(in, pixels, &buzzer, &frame)) {
+        if (frame >= FRAMES || memcmp(pixels, expected[frame], RECORDING_FRAME_BYTES) != 0 || buzzer != expectedBuzzer[frame]) {
+            printf("frame %llu differs\n", (unsigned long long)frame);
+            failures++;
+        }
+        read++;
+    }
+    recording_close(in);
+    remove(CAPTURE_PATH);
+    if (read != FRAMES) {
+        printf("%d frames read back, %d captured\n", read, FRAMES);
+        failures++;
+    }
+
+    if (failures != 0)
+        return EXIT_FAILURE;
+    printf("all passed\n");
+    return EXIT_SUCCESS;
+}
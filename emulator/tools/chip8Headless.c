@@ -0,0 +1,89 @@
+#define _POSIX_C_SOURCE 200809L
+#include "chip8.h"
+#include "streamServer.h"
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// chip8Headless program.ch8 socket [--instances N] [--fps N] [--instructions N]
+// runs a batch of instances of a program without any display and serves them on a unix socket, for chip8View to
+// watch and play any one of them live (see streamServer.h); --fps 0 runs as fast as it can. Ctrl-C quits
+
+#define DEFAULT_INSTANCES 1
+#define MAX_INSTANCES 65536             // the attach message holds 16 bits
+#define DEFAULT_FPS 60
+#define DEFAULT_INSTRUCTIONS 1000       // per frame and instance; cls and Fx0A end a frame earlier
+#define MAX_INSTRUCTIONS 65536
+
+static volatile sig_atomic_t quit = 0;
+
+static void OnSignal(int signalNumber) {
+    (void)signalNumber;
+    quit = 1;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        printf("usage: chip8Headless program.ch8 socket [--instances N] [--fps N] [--instructions N]\n");
+        return EXIT_FAILURE;
+    }
+    long instances = DEFAULT_INSTANCES, fps = DEFAULT_FPS, instructions = DEFAULT_INSTRUCTIONS;
+    for(int argIdx = 3; argIdx < argc; argIdx++) {
+        if (strcmp(argv[argIdx], "--instances") == 0 && argIdx + 1 < argc)
+            instances = atol(argv[++argIdx]);
+        else if (strcmp(argv[argIdx], "--fps") == 0 && argIdx + 1 < argc)
+            fps = atol(argv[++argIdx]);
+        else if (strcmp(argv[argIdx], "--instructions") == 0 && argIdx + 1 < argc)
+            instructions = atol(argv[++argIdx]);
+    }
+    if (instances < 1 || instances > MAX_INSTANCES || fps < 0 || fps > 1000 || instructions < 1 || instructions > MAX_INSTRUCTIONS) {
+        printf("--instances expects 1 to %d, --fps 0 to 1000, --instructions 1 to %d\n", MAX_INSTANCES, MAX_INSTRUCTIONS);
+        return EXIT_FAILURE;
+    }
+
+    Chip8* powerOn = chip8_allocate();
+    chip8_loadProgramFromPath(powerOn, argv[1]);
+    Chip8Pool* pool = chip8_allocatePool((size_t)instances, powerOn);
+    chip8_deallocate(powerOn);
+    Chip8** batch = malloc((size_t)instances * sizeof(Chip8*));
+    for(long idx = 0; idx != instances; idx++)
+        batch[idx] = chip8_poolInstance(pool, (size_t)idx);
+
+    StreamServer* server = streamServer_create(argv[2], batch, (uint32_t)instances);
+    if (server == NULL) {
+        chip8_deallocatePool(pool);
+        free(batch);
+        return EXIT_FAILURE;
+    }
+    signal(SIGINT, OnSignal);
+    signal(SIGTERM, OnSignal);
+    printf("%ld instances of %s, streaming on %s\n", instances, argv[1], argv[2]);
+
+    const long frameNanoseconds = fps != 0 ? 1000000000L / fps : 0;
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    while (!quit) {
+        for(long idx = 0; idx != instances; idx++) {
+            chip8_run(batch[idx], (uint32_t)instructions);
+            chip8_fixedUpdate(batch[idx]);
+        }
+        streamServer_update(server);
+
+        if (frameNanoseconds == 0)
+            continue;
+        next.tv_nsec += frameNanoseconds;
+        while (next.tv_nsec >= 1000000000L) {
+            next.tv_nsec -= 1000000000L;
+            next.tv_sec++;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+    }
+
+    streamServer_destroy(server);
+    chip8_deallocatePool(pool);
+    free(batch);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,159 @@
+#include "recorder.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// chip8RecToPng capture.c8rec prefix [--scale N] [--every-frame]
+// writes prefix_<frame>.png for every frame that differs from the one before (with --every-frame, for every frame,
+// ready for e.g. ffmpeg -framerate 60 -i prefix_%06d.png capture.gif) and lists the buzzer edges on stdout
+
+#define DEFAULT_SCALE 8
+#define MAX_SCALE 32
+#define STORED_BLOCK_MAX 65535
+
+static uint32_t crcTable[256];
+
+static void initCrcTable(void) {
+    for(uint32_t idx = 0; idx != 256; idx++) {
+        uint32_t crc = idx;
+        for(int bit = 0; bit != 8; bit++)
+            crc = crc & 1 ? 0xEDB88320u ^ (crc >> 1) : crc >> 1;
+        crcTable[idx] = crc;
+    }
+}
+
+static uint32_t crc32(uint32_t crc, const uint8_t* data, size_t size) {
+    crc = ~crc;
+    for(size_t idx = 0; idx != size; idx++)
+        crc = crcTable[(crc ^ data[idx]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+static void writeU32(FILE* out, uint32_t value) {
+    const uint8_t bytes[4] = { (uint8_t)(value >> 24), (uint8_t)(value >> 16), (uint8_t)(value >> 8), (uint8_t)value };
+    fwrite(bytes, 1, 4, out);
+}
+
+static void writeChunk(FILE* out, const char type[4], const uint8_t* data, uint32_t size) {
+    writeU32(out, size);
+    fwrite(type, 1, 4, out);
+    fwrite(data, 1, size, out);
+    writeU32(out, crc32(crc32(0, (const uint8_t*)type, 4), data, size));
+}
+
+// 1 bit palette image, its zlib stream made of stored deflate blocks: the frames are tiny, compression isn't worth a dependency
+static bool writePng(const char* path, const uint8_t pixels[RECORDING_FRAME_BYTES], int scale) {
+    FILE* out = fopen(path, "wb");
+    if (out == NULL)
+        return false;
+
+    const uint32_t width = 64 * (uint32_t)scale;
+    const uint32_t height = 32 * (uint32_t)scale;
+    const uint32_t rowSize = 1 + width / 8;   // filter byte, then the row
+    const uint32_t rawSize = rowSize * height;
+    uint8_t* raw = calloc(rawSize, 1);
+    for(uint32_t y = 0; y != height; y++) {
+        const uint8_t* source = &pixels[(y / scale) * 8];
+        uint8_t* row = &raw[y * rowSize + 1];
+        for(uint32_t x = 0; x != width; x++)
+            if (source[(x / scale) / 8] & (0x80 >> ((x / scale) % 8)))
+                row[x / 8] |= (uint8_t)(0x80 >> (x % 8));
+    }
+
+    const uint32_t blocks = (rawSize + STORED_BLOCK_MAX - 1) / STORED_BLOCK_MAX;
+    const uint32_t zlibSize = 2 + blocks * 5 + rawSize + 4;
+    uint8_t* zlib = malloc(zlibSize);
+    uint32_t position = 0;
+    zlib[position++] = 0x78;
+    zlib[position++] = 0x01;
+    uint32_t adlerA = 1, adlerB = 0;
+    for(uint32_t offset = 0; offset < rawSize; offset += STORED_BLOCK_MAX) {
+        const uint32_t size = rawSize - offset < STORED_BLOCK_MAX ? rawSize - offset : STORED_BLOCK_MAX;
+        zlib[position++] = offset + size == rawSize;
+        zlib[position++] = (uint8_t)size;
+        zlib[position++] = (uint8_t)(size >> 8);
+        zlib[position++] = (uint8_t)~size;
+        zlib[position++] = (uint8_t)(~size >> 8);
+        memcpy(&zlib[position], &raw[offset], size);
+        position += size;
+    }
+    for(uint32_t idx = 0; idx != rawSize; idx++) {
+        adlerA = (adlerA + raw[idx]) % 65521;
+        adlerB = (adlerB + adlerA) % 65521;
+    }
+    const uint32_t adler = adlerB << 16 | adlerA;
+    for(int idx = 0; idx != 4; idx++)
+        zlib[position++] = (uint8_t)(adler >> (24 - 8 * idx));
+
+    static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    fwrite(signature, 1, sizeof(signature), out);
+    const uint8_t header[13] = {
+        (uint8_t)(width >> 24), (uint8_t)(width >> 16), (uint8_t)(width >> 8), (uint8_t)width,
+        (uint8_t)(height >> 24), (uint8_t)(height >> 16), (uint8_t)(height >> 8), (uint8_t)height,
+        1, 3, 0, 0, 0   // bit depth 1, palette, deflate, adaptive filtering, no interlace
+    };
+    writeChunk(out, "IHDR", header, sizeof(header));
+    const uint8_t palette[6] = { 0, 0, 0, 0, 117, 44 };   // black and the DARKGREEN of the emulator window
+    writeChunk(out, "PLTE", palette, sizeof(palette));
+    writeChunk(out, "IDAT", zlib, position);
+    writeChunk(out, "IEND", NULL, 0);
+
+    free(zlib);
+    free(raw);
+    return fclose(out) == 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        printf("usage: chip8RecToPng capture.c8rec prefix [--scale N] [--every-frame]\n");
+        return EXIT_FAILURE;
+    }
+
+    int scale = DEFAULT_SCALE;
+    bool everyFrame = false;
+    for(int argIdx = 3; argIdx < argc; argIdx++) {
+        if (strcmp(argv[argIdx], "--scale") == 0 && argIdx + 1 < argc)
+            scale = atoi(argv[++argIdx]);
+        else if (strcmp(argv[argIdx], "--every-frame") == 0)
+            everyFrame = true;
+    }
+    if (scale < 1 || scale > MAX_SCALE) {
+        printf("--scale expects 1 to %d\n", MAX_SCALE);
+        return EXIT_FAILURE;
+    }
+
+    Recording* recording = recording_open(argv[1]);
+    if (recording == NULL) {
+        printf("ERROR: %s is not a chip8 recording\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+    initCrcTable();
+
+    uint8_t pixels[RECORDING_FRAME_BYTES];
+    uint8_t written[RECORDING_FRAME_BYTES];
+    bool buzzer = false, lastBuzzer = false;
+    uint64_t frame = 0, frames = 0, images = 0;
+    while (recording_nextFrame(recording, pixels, &buzzer, &frame)) {
+        frames++;
+        if (buzzer != lastBuzzer)
+            printf("frame %llu buzzer %s\n", (unsigned long long)frame, buzzer ? "on" : "off");
+        lastBuzzer = buzzer;
+
+        if (!everyFrame && images != 0 && memcmp(pixels, written, RECORDING_FRAME_BYTES) == 0)
+            continue;
+        char path[4096];
+        snprintf(path, sizeof(path), "%s_%06llu.png", argv[2], (unsigned long long)frame);
+        if (!writePng(path, pixels, scale)) {
+            printf("ERROR: can't write %s\n", path);
+            recording_close(recording);
+            return EXIT_FAILURE;
+        }
+        memcpy(written, pixels, RECORDING_FRAME_BYTES);
+        images++;
+    }
+    recording_close(recording);
+
+    printf("%llu frames, %llu images\n", (unsigned long long)frames, (unsigned long long)images);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,88 @@
+#define _POSIX_C_SOURCE 200809L
+#include "chip8.h"
+#include "recorder.h"
+#include "terminalScreen.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// chip8Term program.ch8 [--fps N] [--bell]
+// the emulator in a terminal (see terminalScreen.h), the changed cells are written in one write per frame; Esc or Ctrl-C quits
+
+#define DEFAULT_FPS 60
+#define INSTRUCTIONS_PER_FRAME 65536    // for programs that never wait for the next frame
+#define KEY_HOLD_FRAMES 6
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        printf("usage: chip8Term program.ch8 [--fps N] [--bell]\n");
+        return EXIT_FAILURE;
+    }
+    int fps = DEFAULT_FPS;
+    bool bell = false;
+    for(int argIdx = 2; argIdx < argc; argIdx++) {
+        if (strcmp(argv[argIdx], "--fps") == 0 && argIdx + 1 < argc)
+            fps = atoi(argv[++argIdx]);
+        else if (strcmp(argv[argIdx], "--bell") == 0)
+            bell = true;
+    }
+    if (fps < 1 || fps > 1000) {
+        printf("--fps expects 1 to 1000\n");
+        return EXIT_FAILURE;
+    }
+
+    Chip8* c = chip8_allocate();
+    chip8_loadProgramFromPath(c, argv[1]);
+
+    if (!terminalScreen_enter()) {
+        printf("ERROR: stdin is not a terminal\n");
+        return EXIT_FAILURE;
+    }
+
+    static char out[TERMINAL_DIFF_BYTES];
+    static uint8_t cells[TERMINAL_CELL_ROWS][TERMINAL_CELL_COLUMNS];
+    int keyFrames[16] = { 0 };
+    bool buzzing = false;
+
+    const long frameNanoseconds = 1000000000L / fps;
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    while (!terminalScreen_quit()) {
+        terminalScreen_readKeys(keyFrames, KEY_HOLD_FRAMES);
+        uint16_t pressedKeys = 0;
+        for(int key = 0; key != 16; key++) {
+            if (keyFrames[key] > 0) {
+                pressedKeys |= (uint16_t)(1 << key);
+                keyFrames[key]--;
+            }
+        }
+        chip8_setKeys(c, pressedKeys);
+
+        // cls and Fx0A stop the run, nothing changes before the next chip8_fixedUpdate
+        chip8_run(c, INSTRUCTIONS_PER_FRAME);
+        chip8_fixedUpdate(c);
+
+        uint8_t frame[RECORDING_FRAME_BYTES];
+        recording_packFrame(c, frame);
+        size_t size = terminalScreen_diff(frame, cells, out);
+        const bool buzzer = chip8_getBuzzer(c);
+        if (bell && buzzer && !buzzing)
+            out[size++] = '\a';
+        buzzing = buzzer;
+        if (size != 0)
+            (void)!write(STDOUT_FILENO, out, size);
+
+        next.tv_nsec += frameNanoseconds;
+        while (next.tv_nsec >= 1000000000L) {
+            next.tv_nsec -= 1000000000L;
+            next.tv_sec++;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+    }
+
+    chip8_deallocate(c);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,152 @@
+#define _POSIX_C_SOURCE 200809L
+#include "recorder.h"
+#include "streamServer.h"
+#include "terminalScreen.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+// chip8View socket instance [--bell]
+// watches one instance of a running chip8Headless batch in the terminal (see terminalScreen.h) and plays it with the
+// keyboard; Esc or Ctrl-C quits, the batch keeps running
+
+#define TICK_NANOSECONDS 16666667L      // the screen is drawn and the keys polled once a frame
+#define KEY_HOLD_FRAMES 6
+#define INPUT_BYTES 4096
+
+static int Connect(const char* path) {
+    struct sockaddr_un address = { .sun_family = AF_UNIX };
+    if (strlen(path) >= sizeof(address.sun_path))
+        return -1;
+    strcpy(address.sun_path, path);
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd != -1 && connect(fd, (const struct sockaddr*)&address, sizeof(address)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static long long Nanoseconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+static bool Send(int fd, uint8_t type, uint8_t first, uint8_t second) {
+    const uint8_t message[STREAM_MESSAGE_BYTES] = { type, first, second, 0 };
+    return send(fd, message, sizeof(message), MSG_NOSIGNAL) == sizeof(message);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        printf("usage: chip8View socket instance [--bell]\n");
+        return EXIT_FAILURE;
+    }
+    const long instance = atol(argv[2]);
+    bool bell = false;
+    for(int argIdx = 3; argIdx < argc; argIdx++)
+        if (strcmp(argv[argIdx], "--bell") == 0)
+            bell = true;
+    if (instance < 0 || instance > UINT16_MAX) {
+        printf("instance expects 0 to %d\n", UINT16_MAX);
+        return EXIT_FAILURE;
+    }
+
+    const int fd = Connect(argv[1]);
+    if (fd == -1) {
+        printf("ERROR: nothing streams on %s\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+    Send(fd, STREAM_ATTACH, (uint8_t)instance, (uint8_t)(instance >> 8));
+
+    if (!terminalScreen_enter()) {
+        printf("ERROR: stdin is not a terminal\n");
+        return EXIT_FAILURE;
+    }
+    char status[64];
+    const int statusSize = snprintf(status, sizeof(status), "\x1b[%d;1Hinstance %ld of %s", TERMINAL_CELL_ROWS + 1, instance, argv[1]);
+    (void)!write(STDOUT_FILENO, status, (size_t)statusSize < sizeof(status) ? (size_t)statusSize : sizeof(status) - 1);
+
+    static char out[TERMINAL_DIFF_BYTES + 1];
+    static uint8_t cells[TERMINAL_CELL_ROWS][TERMINAL_CELL_COLUMNS];
+    static uint8_t input[INPUT_BYTES];
+    size_t inputSize = 0;
+    bool headerSeen = false;
+    uint8_t pixels[RECORDING_FRAME_BYTES] = { 0 };
+    bool buzzer = false, buzzing = false;
+    int keyFrames[16] = { 0 };
+    uint16_t sentKeys = 0;
+    const char* error = NULL;
+
+    long long nextTick = Nanoseconds();
+    while (!terminalScreen_quit() && error == NULL) {
+        const long long wait = nextTick - Nanoseconds();
+        struct pollfd waitFor = { .fd = fd, .events = POLLIN };
+        if (poll(&waitFor, 1, wait > 0 ? (int)((wait + 999999) / 1000000) : 0) > 0) {
+            const ssize_t size = recv(fd, &input[inputSize], INPUT_BYTES - inputSize, 0);
+            if (size <= 0 && !(size < 0 && errno == EINTR)) {
+                error = "the batch is gone";
+                break;
+            }
+            inputSize += size > 0 ? (size_t)size : 0;
+        }
+
+        // a header, then frame records
+        size_t used = 0;
+        if (!headerSeen && inputSize >= RECORDING_HEADER_BYTES) {
+            if (!recording_checkHeader(input)) {
+                error = "not a chip8 stream";
+                break;
+            }
+            headerSeen = true;
+            used = RECORDING_HEADER_BYTES;
+        }
+        while (headerSeen && used < inputSize) {
+            const int recordSize = recording_decodeFrame(&input[used], inputSize - used, pixels, &buzzer);
+            if (recordSize < 0)
+                error = "damaged stream";
+            if (recordSize <= 0)
+                break;
+            used += (size_t)recordSize;
+        }
+        memmove(input, &input[used], inputSize - used);
+        inputSize -= used;
+        if (Nanoseconds() < nextTick)
+            continue;
+        nextTick += TICK_NANOSECONDS;
+
+        size_t size = terminalScreen_diff(pixels, cells, out);
+        if (bell && buzzer && !buzzing)
+            out[size++] = '\a';
+        buzzing = buzzer;
+        if (size != 0)
+            (void)!write(STDOUT_FILENO, out, size);
+
+        terminalScreen_readKeys(keyFrames, KEY_HOLD_FRAMES);
+        for(int key = 0; key != 16; key++) {
+            const bool down = keyFrames[key] > 0;
+            if (down)
+                keyFrames[key]--;
+            if (down != (bool)(sentKeys >> key & 1)) {
+                Send(fd, STREAM_KEY, (uint8_t)key, down);
+                sentKeys ^= (uint16_t)(1 << key);
+            }
+        }
+    }
+
+    close(fd);
+    if (error != NULL) {
+        const int size = snprintf(out, sizeof(out), "\x1b[%d;1H\x1b[2K%s", TERMINAL_CELL_ROWS + 1, error);
+        (void)!write(STDOUT_FILENO, out, (size_t)size);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
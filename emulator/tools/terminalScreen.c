@@ -0,0 +1,100 @@
+#define _POSIX_C_SOURCE 200809L
+#include "terminalScreen.h"
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+#define ESCAPE 0x1B
+
+// a cell holds its top pixel in bit 0 and its bottom one in bit 1
+static const char* const glyphs[4] = { " ", "\xE2\x96\x80", "\xE2\x96\x84", "\xE2\x96\x88" };   // space, ▀, ▄, █
+
+static struct termios savedTerminal;
+static volatile sig_atomic_t quit = 0;
+
+// chip8 key for each character, -1 for the others; the keypad on the left of a qwerty keyboard
+static int keyOf(char character) {
+    static const char layout[] = "x123qweasdzc4rfv";
+    for(int key = 0; key != 16; key++)
+        if (layout[key] == character)
+            return key;
+    return -1;
+}
+
+static void onSignal(int signalNumber) {
+    (void)signalNumber;
+    quit = 1;
+}
+
+static void restoreTerminal(void) {
+    static const char restore[] = "\x1b[0m\x1b[?25h\r\n";
+    tcsetattr(STDIN_FILENO, TCSAFLUSH, &savedTerminal);
+    (void)!write(STDOUT_FILENO, restore, sizeof(restore) - 1);
+}
+
+bool terminalScreen_enter(void) {
+    if (tcgetattr(STDIN_FILENO, &savedTerminal) != 0)
+        return false;
+    struct termios raw = savedTerminal;
+    raw.c_lflag &= ~(tcflag_t)(ICANON | ECHO);
+    raw.c_iflag &= ~(tcflag_t)(IXON | ICRNL);
+    raw.c_cc[VMIN] = 0;
+    raw.c_cc[VTIME] = 0;
+    if (tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw) != 0)
+        return false;
+    atexit(restoreTerminal);
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+    signal(SIGHUP, onSignal);
+
+    static const char setup[] = "\x1b[?25l\x1b[2J";
+    (void)!write(STDOUT_FILENO, setup, sizeof(setup) - 1);
+    return true;
+}
+
+bool terminalScreen_quit(void) {
+    return quit;
+}
+
+size_t terminalScreen_diff(const uint8_t frame[RECORDING_FRAME_BYTES], uint8_t cells[TERMINAL_CELL_ROWS][TERMINAL_CELL_COLUMNS], char* out) {
+    size_t size = 0;
+    int cursorRow = -1, cursorColumn = -1;
+    for(int row = 0; row != TERMINAL_CELL_ROWS; row++) {
+        const uint8_t* top = &frame[(row * 2) * TERMINAL_CELL_COLUMNS / 8];
+        const uint8_t* bottom = &frame[(row * 2 + 1) * TERMINAL_CELL_COLUMNS / 8];
+        for(int column = 0; column != TERMINAL_CELL_COLUMNS; column++) {
+            const uint8_t mask = (uint8_t)(0x80 >> (column % 8));
+            const uint8_t cell = (uint8_t)((top[column / 8] & mask ? 1 : 0) | (bottom[column / 8] & mask ? 2 : 0));
+            if (cell == cells[row][column])
+                continue;
+            cells[row][column] = cell;
+
+            // the cursor moves on by itself after a glyph, runs of changed cells need a single jump
+            if (row != cursorRow || column != cursorColumn)
+                size += (size_t)sprintf(&out[size], "\x1b[%d;%dH", row + 1, column + 1);
+            const size_t glyphSize = strlen(glyphs[cell]);
+            memcpy(&out[size], glyphs[cell], glyphSize);
+            size += glyphSize;
+            cursorRow = row;
+            cursorColumn = column + 1;
+        }
+    }
+    return size;
+}
+
+void terminalScreen_readKeys(int keyFrames[16], int holdFrames) {
+    char input[64];
+    const ssize_t count = read(STDIN_FILENO, input, sizeof(input));
+    for(ssize_t idx = 0; idx < count; idx++) {
+        // a lone Esc quits, escape sequences (arrows and such) start with one and are longer
+        if (input[idx] == ESCAPE && count == 1)
+            quit = 1;
+        const int key = keyOf(input[idx] >= 'A' && input[idx] <= 'Z' ? (char)(input[idx] - 'A' + 'a') : input[idx]);
+        if (key >= 0)
+            keyFrames[key] = holdFrames;
+    }
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "recorder.h"
+
+// the screen in a terminal for chip8Term and chip8View: two pixels per character cell with half blocks, only the cells
+// that changed since the last frame are redrawn; keys as in the window (1234/qwer/asdf/zxcv)
+
+#define TERMINAL_CELL_ROWS 16
+#define TERMINAL_CELL_COLUMNS 64
+// worst case is every cell with a jump in front of it
+#define TERMINAL_DIFF_BYTES (TERMINAL_CELL_ROWS * TERMINAL_CELL_COLUMNS * (sizeof("\x1b[16;64H") + 3) + 1)
+
+// no echo, no line buffering, reads return at once; hides the cursor and clears the screen, all undone at exit.
+// False when stdin is not a terminal
+bool terminalScreen_enter(void);
+// true once Esc was typed, or on Ctrl-C, SIGTERM or SIGHUP
+bool terminalScreen_quit(void);
+
+// appends the escape sequences redrawing the cells that differ from cells (blank after terminalScreen_enter),
+// and updates them; returns their size, at most TERMINAL_DIFF_BYTES
+size_t terminalScreen_diff(const uint8_t frame[RECORDING_FRAME_BYTES], uint8_t cells[TERMINAL_CELL_ROWS][TERMINAL_CELL_COLUMNS], char* out);
+
+// reads what was typed and sets keyFrames to holdFrames for the chip8 keys among it; terminals only report presses,
+// a key counts as down for that many frames (and on repeats)
+void terminalScreen_readKeys(int keyFrames[16], int holdFrames);